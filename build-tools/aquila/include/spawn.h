@@ -0,0 +1,13 @@
+#ifndef _SPAWN_H
+#define _SPAWN_H
+
+#include <sys/types.h>
+
+/* Not supported yet, posix_spawn only accepts NULL for both */
+typedef struct { int __unused; } posix_spawnattr_t;
+typedef struct { int __unused; } posix_spawn_file_actions_t;
+
+int posix_spawn(pid_t *pid, const char *path, const posix_spawn_file_actions_t *file_actions,
+        const posix_spawnattr_t *attrp, char *const argv[], char *const envp[]);
+
+#endif /* ! _SPAWN_H */
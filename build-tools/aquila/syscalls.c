@@ -4,8 +4,14 @@
 #include <sys/times.h>
 #include <sys/errno.h>
 #include <sys/time.h>
+#include <bits/clock.h>
 #include <sys/mount.h>
 #include <sys/utsname.h>
+#include <sys/mman.h>
+#include <spawn.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <dirent.h>
@@ -24,6 +30,7 @@
 #define SYS_OPEN	11
 #define SYS_READ	12
 #define SYS_SBRK	13
+#define SYS_TIMES   15
 #define SYS_WAITPID 17
 #define SYS_WRITE	18
 #define SYS_IOCTL	19
@@ -36,6 +43,15 @@
 #define SYS_FCNTL   26
 #define SYS_CHDIR   27
 #define SYS_GETCWD  28
+#define SYS_MMAP    29
+#define SYS_MUNMAP  30
+#define SYS_MPROTECT 31
+#define SYS_VFORK   32
+#define SYS_POSIX_SPAWN 33
+#define SYS_NICE    34
+#define SYS_NANOSLEEP   35
+#define SYS_SETITIMER   36
+#define SYS_POLL    37
 
 #define SYSCALL3(ret, v, arg1, arg2, arg3) \
 	asm volatile("int $0x80;":"=a"(ret):"a"(v), "b"(arg1), "c"(arg2), "d"(arg3));
@@ -199,7 +215,10 @@ int stat(const char *file, struct stat *st)
 
 clock_t times(struct tms *buf)
 {
-    
+    /* Can not fail, the elapsed time is free to wrap into negative values */
+    clock_t ret;
+    SYSCALL1(ret, SYS_TIMES, buf);
+    return ret;
 }
 
 int unlink(char *name)
@@ -238,8 +257,80 @@ ssize_t write(int fildes, const void *buf, size_t nbytes)
     return ret;
 }
 
+/*
+ * The kernel keeps the time in a page mapped read-only in every process,
+ * reading it needs no system call. See kernel/include/bits/clock.h
+ */
+#define CLOCK_PAGE  0xFF400000
+
+#ifndef CLOCK_REALTIME
+#define CLOCK_REALTIME  (clockid_t) 1
+#endif
+
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC (clockid_t) 4
+#endif
+
+static inline uint64_t __rdtsc()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc":"=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static void __clock_monotonic(struct timespec *ts)
+{
+    const volatile struct clock_data *cd = (const volatile struct clock_data *) CLOCK_PAGE;
+    uint32_t seq, sec;
+    uint64_t nsec;
+
+    do {
+        while ((seq = cd->seq) & 1);    /* Being updated */
+        asm volatile("":::"memory");
+
+        sec  = cd->mono_sec;
+        nsec = cd->mono_nsec;
+
+        if (cd->tsc_mult) {
+            uint32_t cycles = (uint32_t) (__rdtsc() - cd->tsc_base);
+            nsec += ((uint64_t) cycles * cd->tsc_mult) >> cd->tsc_shift;
+        }
+
+        asm volatile("":::"memory");
+    } while (cd->seq != seq);
+
+    while (nsec >= 1000000000) {
+        nsec -= 1000000000;
+        ++sec;
+    }
+
+    ts->tv_sec  = sec;
+    ts->tv_nsec = nsec;
+}
+
+int clock_gettime(clockid_t clock_id, struct timespec *tp)
+{
+    if (clock_id != CLOCK_REALTIME && clock_id != CLOCK_MONOTONIC) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    __clock_monotonic(tp);
+
+    if (clock_id == CLOCK_REALTIME)
+        tp->tv_sec += ((const volatile struct clock_data *) CLOCK_PAGE)->boot_time;
+
+    return 0;
+}
+
 int gettimeofday(struct timeval *p, void *z)
 {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    p->tv_sec  = ts.tv_sec;
+    p->tv_usec = ts.tv_nsec / 1000;
+
     return 0;
 }
 
@@ -403,3 +494,180 @@ int getcwd(char *buf, size_t size)
 
     return 0;
 }
+
+void *mmap(void *addr, size_t len, int prot, int flags, int fildes, off_t off)
+{
+    struct mmap_args {
+        void *addr;
+        size_t len;
+        int prot;
+        int flags;
+        int fildes;
+        off_t off;
+    } __attribute__((packed)) args = {
+        addr, len, prot, flags, fildes, off
+    };
+
+    unsigned long ret;
+    SYSCALL1(ret, SYS_MMAP, &args);
+
+    /* Mappings may live above 2 GiB, errors are the last page of values */
+    if (ret > -4096UL) {
+        errno = -ret;
+        return MAP_FAILED;
+    }
+
+    return (void *) ret;
+}
+
+int munmap(void *addr, size_t len)
+{
+    int ret;
+    SYSCALL2(ret, SYS_MUNMAP, addr, len);
+
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    return 0;
+}
+
+int mprotect(void *addr, size_t len, int prot)
+{
+    int ret;
+    SYSCALL3(ret, SYS_MPROTECT, addr, len, prot);
+
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    return 0;
+}
+
+int nice(int incr)
+{
+    /* Never fails, the new nice value is returned (might be negative) */
+    int ret;
+    SYSCALL1(ret, SYS_NICE, incr);
+    return ret;
+}
+
+int nanosleep(const struct timespec *rqtp, struct timespec *rmtp)
+{
+    int ret;
+    SYSCALL2(ret, SYS_NANOSLEEP, rqtp, rmtp);
+
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    return ret;
+}
+
+unsigned sleep(unsigned seconds)
+{
+    struct timespec ts = {seconds, 0};
+
+    if (nanosleep(&ts, &ts))
+        return ts.tv_sec + !!ts.tv_nsec;
+
+    return 0;
+}
+
+int usleep(useconds_t useconds)
+{
+    struct timespec ts = {useconds / 1000000, (useconds % 1000000) * 1000};
+    return nanosleep(&ts, NULL);
+}
+
+int setitimer(int which, const struct itimerval *value, struct itimerval *ovalue)
+{
+    int ret;
+    SYSCALL3(ret, SYS_SETITIMER, which, value, ovalue);
+
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    return ret;
+}
+
+int getitimer(int which, struct itimerval *value)
+{
+    /* The kernel only reports the current value if there is no new one */
+    return setitimer(which, NULL, value);
+}
+
+unsigned alarm(unsigned seconds)
+{
+    struct itimerval new = {{0, 0}, {seconds, 0}}, old;
+
+    if (setitimer(ITIMER_REAL, &new, &old))
+        return 0;
+
+    /* Rounded up, a pending alarm never reports 0 seconds left */
+    return old.it_value.tv_sec + !!old.it_value.tv_usec;
+}
+
+int poll(struct pollfd fds[], nfds_t nfds, int timeout)
+{
+    int ret;
+    SYSCALL3(ret, SYS_POLL, fds, nfds, timeout);
+
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    return ret;
+}
+
+/*
+ * The vfork child returns on the parent's stack and overwrites the return
+ * address with its next call, so keep it in a register across the syscall.
+ */
+__attribute__((regparm(1), used)) static int __vfork_error(int ret)
+{
+    errno = -ret;
+    return -1;
+}
+
+asm(
+    ".text              \n"
+    ".global vfork      \n"
+    "vfork:             \n"
+    "   pop %ecx        \n"    /* Return address */
+    "   mov $32, %eax   \n"    /* SYS_VFORK */
+    "   int $0x80       \n"
+    "   push %ecx       \n"
+    "   test %eax, %eax \n"
+    "   js __vfork_error\n"
+    "   ret             \n"
+);
+
+int posix_spawn(pid_t *pid, const char *path, const posix_spawn_file_actions_t *file_actions,
+        const posix_spawnattr_t *attrp, char *const argv[], char *const envp[])
+{
+    /* File actions and attributes are not supported yet */
+    if (file_actions || attrp)
+        return ENOSYS;
+
+    struct posix_spawn_args {
+        pid_t *pid;
+        const char *path;
+        char *const *argv;
+        char *const *envp;
+    } __attribute__((packed)) args = {
+        pid, path, argv, envp
+    };
+
+    int ret;
+    SYSCALL1(ret, SYS_POSIX_SPAWN, &args);
+
+    /* Returns the error number instead of setting errno */
+    return ret < 0 ? -ret : 0;
+}
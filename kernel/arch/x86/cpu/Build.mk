@@ -5,6 +5,10 @@ obj-y += idt.o
 obj-y += isr.o
 obj-y += pic.o
 obj-y += pit.o
+obj-y += tsc.o
+obj-y += rtc.o
+obj-y += lapic.o
+obj-y += clockevent.o
 obj-y += sdt.o
 obj-y += smp.o
 obj-y += sys.o
@@ -0,0 +1,70 @@
+/**********************************************************************
+ *                  Clock Event Devices
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <cpu/cpu.h>
+
+/* Best first, the PIT is always there */
+static struct clock_event *clock_events[] = {
+    &tsc_deadline_clock_event,
+    &lapic_clock_event,
+    &pit_clock_event,
+};
+
+struct clock_event *clock_event = NULL;
+
+static irq_handler_t clock_event_handler = NULL;
+static uint32_t emulated_period = 0;    /* in us, when periodic mode is emulated */
+
+static void clock_event_irq(regs_t *r)
+{
+    if (emulated_period)
+        clock_event->oneshot(emulated_period);
+
+    clock_event_handler(r);
+}
+
+void clock_event_setup(irq_handler_t handler)
+{
+    tsc_calibrate();
+
+    for (size_t i = 0; i < sizeof(clock_events)/sizeof(clock_events[0]); ++i) {
+        if (!clock_events[i]->probe()) {
+            clock_event = clock_events[i];
+            break;
+        }
+    }
+
+    /* Whatever the firmware left the PIT doing would keep waking us up */
+    if (clock_event != &pit_clock_event)
+        pit_stop();
+
+    printk("[0] Kernel: Clock event -> %s\n", clock_event->name);
+
+    clock_event_handler = handler;
+    irq_install_handler(clock_event->irq, clock_event_irq);
+}
+
+void clock_event_periodic(uint32_t hz)
+{
+    if (clock_event->periodic) {
+        emulated_period = 0;
+        clock_event->periodic(hz);
+    } else {
+        emulated_period = 1000000 / hz;
+        clock_event->oneshot(emulated_period);
+    }
+}
+
+void clock_event_oneshot(uint32_t us)
+{
+    emulated_period = 0;
+    clock_event->oneshot(MIN(us, clock_event->max_oneshot));
+}
@@ -18,6 +18,20 @@ void disable_fpu()
     write_cr0(read_cr0() | CR0_EM);
 }
 
+/*
+ *  The FPU registers still hold the context of the last process that used
+ *  them, that one can have the FPU right away, anyone else traps first.
+ *  Writing CR0 is serializing, only do it if the state actually changes.
+ */
+void switch_fpu(proc_t *proc)
+{
+    uint32_t cr0 = read_cr0();
+    uint32_t new = proc == last_fpu_proc ? (cr0 & ~CR0_EM) | CR0_MP : cr0 | CR0_EM;
+
+    if (new != cr0)
+        write_cr0(new);
+}
+
 void init_fpu()
 {
     asm volatile("fninit");
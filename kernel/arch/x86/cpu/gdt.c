@@ -11,6 +11,7 @@
 
 #include <core/system.h>
 #include <core/string.h>
+#include <cpu/cpu.h>
 
 struct {
     uint32_t link;
@@ -22,6 +23,20 @@ struct {
 #define TSS_BASE    ((uintptr_t) &tss_entry)
 #define TSS_LIMIT   (sizeof(tss_entry))
 
+/* Task used for handling double faults */
+struct {
+    uint32_t link;
+    uint32_t esp0, ss0, esp1, ss1, esp2, ss2;
+    uint32_t cr3, eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs;
+    uint32_t ldt;
+    uint32_t iomap;
+} __packed df_tss __aligned(8);
+
+#define DF_TSS_BASE    ((uintptr_t) &df_tss)
+#define DF_TSS_LIMIT   (sizeof(df_tss))
+
 #define RW_DATA	0x2
 #define XR_CODE	0xA
 #define TSS_AVL	0x9
@@ -99,6 +114,23 @@ void set_tss_esp(uint32_t esp)
     asm volatile ("ltr %%ax;"::"a"(0x28 | DPL3));
 }
 
+void set_df_task(uintptr_t eip, uintptr_t esp)
+{
+	memset(&df_tss, 0, sizeof(df_tss));
+
+	df_tss.cr3 = read_cr3();
+	df_tss.eip = eip;
+	df_tss.esp = esp;
+	df_tss.eflags = 0x2;    /* Interrupts disabled */
+	df_tss.cs = 0x08;
+	df_tss.ss = df_tss.ds = df_tss.es = df_tss.fs = df_tss.gs = 0x10;
+	df_tss.iomap = sizeof(df_tss);
+
+	gdt[6] = (struct gdt_entry){DF_TSS_LIMIT & 0xFFFF, DF_TSS_BASE & 0xFFFF,
+		(DF_TSS_BASE >> 16) & 0xFF, TSS_AVL, 0, DPL0, 1,
+		(DF_TSS_LIMIT >> 16) & 0xF, 0, 0, 0, 0, (DF_TSS_BASE >> 24 & 0xFF)};
+}
+
 void set_kernel_stack(uintptr_t esp)
 {
 	tss_entry.esp = esp;
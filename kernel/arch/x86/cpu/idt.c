@@ -55,6 +55,18 @@ void idt_set_gate_user(uint32_t id, uint32_t offset)
 	idt[id].flags = 0x0E;
 }
 
+/* Sets Task gate to the TSS in selector */
+void idt_set_task_gate(uint32_t id, uint16_t selector)
+{
+	idt[id].offset_lo = 0;
+	idt[id].offset_hi = 0;
+
+	idt[id].selector = selector;
+	idt[id].p = 1;
+	idt[id].dpl = DPL0;
+	idt[id].flags = 0x05;
+}
+
 void idt_setup()
 {
 	asm volatile("lidtl (%0)"::"g"(idt_pointer));
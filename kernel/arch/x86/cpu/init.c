@@ -53,9 +53,9 @@ void cpu_init()
     vmm_setup();
 
     set_tss_esp(VMA(0x100000));
+    df_setup();
 
     pic_setup();
-    pit_setup(20);
 
     extern void kmain(struct boot *);
     kmain(boot);
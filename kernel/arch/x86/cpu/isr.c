@@ -15,6 +15,7 @@
 #include <core/arch.h>
 #include <sys/sched.h>
 #include <mm/mm.h>
+#include <mm/vmalloc.h>
 
 extern void isr0 (void);
 extern void isr1 (void);
@@ -113,10 +114,26 @@ void interrupt(regs_t *regs)
             return_from_signal((uintptr_t) arch->regs);
         }
 
-        pmman.handle_page_fault(read_cr2());
+        x86_proc_t *arch = cur_proc->arch;
+        arch->regs = regs;  /* In case a signal is delivered */
+
+        pmman.handle_page_fault(read_cr2(), err_num);
         return;
     }
 
+    if (int_num == 0xE && regs->cs != X86_CS) {   /* Page fault from kernel-space */
+        uintptr_t addr = read_cr2();
+
+        if (!vmalloc_fault(addr))
+            return;
+
+        /* Kernel touching user memory, e.g. copy-on-write syscall buffers */
+        if (cur_proc && addr < USER_STACK) {
+            pmman.handle_page_fault(addr, err_num);
+            return;
+        }
+    }
+
     if (int_num == 0x07) {  /* FPU Trap */
         trap_fpu();
         return;
@@ -144,6 +161,25 @@ void interrupt(regs_t *regs)
     }
 }
 
+/*
+ *  Double faults are handled by a separate task with its own stack, a kernel
+ *  stack overflow into the guard page would otherwise triple fault
+ */
+
+static char df_stack[4096] __aligned(16);
+
+static void double_fault()
+{
+    uintptr_t cr2 = read_cr2();
+    printk("Recieved interrupt 8: %s\n", int_msg[8]);
+    printk("CR2 = %p\n", cr2);
+
+    /* Panics if cr2 is in a guard page */
+    vmalloc_fault(cr2);
+
+    panic("Kernel Exception");
+}
+
 void isr_setup()
 {	
 	idt_set_gate(0x00, (uint32_t) isr0);
@@ -180,3 +216,9 @@ void isr_setup()
 	idt_set_gate(0x1F, (uint32_t) isr31);
 	idt_set_gate_user(0x80, (uint32_t) isr128);
 }
+
+void df_setup()
+{
+	set_df_task((uintptr_t) double_fault, (uintptr_t) df_stack + sizeof(df_stack));
+	idt_set_task_gate(0x08, DF_TSS_SELECTOR);
+}
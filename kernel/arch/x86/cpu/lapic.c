@@ -0,0 +1,151 @@
+/**********************************************************************
+ *                  Local APIC (LAPIC)
+ *
+ *
+ *  Only the timer is used for now, interrupts are still routed through
+ *  the legacy PIC.
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <cpu/cpu.h>
+#include <mm/mm.h>
+
+#define APIC_BASE_ENABLE    _BV(11)
+#define CPUID_TSC_DEADLINE  _BV(24)     /* CPUID.1:ECX */
+
+#define LAPIC_CALIBRATE_MS  10
+
+static int lapic_mapped = 0;
+static uint32_t lapic_ticks_per_ms = 0;
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return *(volatile uint32_t *) (LAPIC_VIRT + reg);
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t val)
+{
+    *(volatile uint32_t *) (LAPIC_VIRT + reg) = val;
+}
+
+int lapic_setup()
+{
+    if (lapic_mapped)
+        return 0;
+
+    struct cpu_features features;
+    get_cpu_features(&features);
+
+    if (!features.apic || !features.msr)
+        return -1;
+
+    uint64_t base = msr_read(APIC_BASE);
+    msr_write(APIC_BASE, base | APIC_BASE_ENABLE);
+
+    if (!pmman.map_to((uintptr_t) base & ~PAGE_MASK, LAPIC_VIRT, PAGE_SIZE, KRW | MIO | MUC))
+        return -1;
+
+    extern void lapic_spurious();
+    idt_set_gate(LAPIC_SPURIOUS_VECTOR, (uint32_t) lapic_spurious);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    lapic_mapped = 1;
+    return 0;
+}
+
+void lapic_eoi()
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/* ================== LAPIC Timer ================== */
+
+/* The timer runs off the bus clock, count it down over a delay timed by the PIT */
+static void lapic_timer_calibrate()
+{
+    lapic_write(LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_ICR, 0xFFFFFFFF);
+
+    pit_delay(LAPIC_CALIBRATE_MS * 1000);
+
+    uint32_t ticks = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CCR);
+    lapic_write(LAPIC_TIMER_ICR, 0);
+
+    lapic_ticks_per_ms = ticks / LAPIC_CALIBRATE_MS;
+}
+
+static int lapic_timer_probe()
+{
+    if (lapic_setup())
+        return -1;
+
+    lapic_timer_calibrate();
+
+    if (!lapic_ticks_per_ms)
+        return -1;
+
+    /* The count must fit in 32 bits */
+    lapic_clock_event.max_oneshot = MIN(0xFFFFFFFF / lapic_ticks_per_ms, 1000) * 1000;
+
+    return 0;
+}
+
+static void lapic_timer_periodic(uint32_t hz)
+{
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_ICR, div_u64_u32((uint64_t) lapic_ticks_per_ms * 1000, hz));
+}
+
+static void lapic_timer_oneshot(uint32_t us)
+{
+    uint32_t count = div_u64_u32((uint64_t) lapic_ticks_per_ms * us, 1000);
+
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_ICR, MAX(count, 1));
+}
+
+struct clock_event lapic_clock_event = {
+    .name     = "lapic",
+    .irq      = LAPIC_TIMER_IRQ,
+    .probe    = lapic_timer_probe,
+    .periodic = lapic_timer_periodic,
+    .oneshot  = lapic_timer_oneshot,
+};
+
+/* ================== TSC Deadline ================== */
+
+static int tsc_deadline_probe()
+{
+    uint32_t ecx;
+    asm volatile("cpuid":"=c"(ecx):"a"(1):"ebx", "edx");
+
+    if (!(ecx & CPUID_TSC_DEADLINE) || !tsc_khz || lapic_setup())
+        return -1;
+
+    return 0;
+}
+
+static void tsc_deadline_oneshot(uint32_t us)
+{
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_TSC_DEADLINE | LAPIC_TIMER_VECTOR);
+
+    /* The LVT write must land before the deadline is armed */
+    asm volatile("mfence":::"memory");
+    msr_write(IA32_TSC_DEADLINE, read_tsc() + div_u64_u32((uint64_t) tsc_khz * us, 1000));
+}
+
+/* No periodic mode, emulated by re-arming the deadline */
+struct clock_event tsc_deadline_clock_event = {
+    .name     = "tsc-deadline",
+    .irq      = LAPIC_TIMER_IRQ,
+    .max_oneshot = 500000,  /* Keeps the cycle count in 32 bits up to 8 GHz */
+    .probe    = tsc_deadline_probe,
+    .periodic = NULL,
+    .oneshot  = tsc_deadline_oneshot,
+};
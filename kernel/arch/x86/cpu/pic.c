@@ -14,6 +14,8 @@
 #include <core/system.h>
 #include <cpu/cpu.h>
 #include <cpu/io.h>
+#include <core/arch.h>
+#include <sys/sched.h>
 
 #define MASTER_PIC_CMD	0x20
 #define MASTER_PIC_DATA	0x21
@@ -107,24 +109,30 @@ extern void irq12(void);
 extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
+extern void irq16(void);
 
-static irq_handler_t irq_handlers[16] = {0};
+static irq_handler_t irq_handlers[NR_IRQS] = {0};
 
 void irq_install_handler(unsigned irq, irq_handler_t handler)
 {
-	if (irq < 16)
+	if (irq < NR_IRQS)
 		irq_handlers[irq] = handler;
 }
 
 void irq_uninstall_handler(unsigned irq)
 {
-	if (irq < 16)
+	if (irq < NR_IRQS)
 		irq_handlers[irq] = (irq_handler_t) NULL;
 }
 
 #define IRQ_ACK	0x20
 void irq_ack(uint32_t irq_no)
 {
+	if (irq_no == LAPIC_TIMER_IRQ) {
+		lapic_eoi();
+		return;
+	}
+
 	if (irq_no > 7)	/* IRQ fired from the Slave PIC */
 		outb(SLAVE_PIC_CMD, IRQ_ACK);
 
@@ -139,7 +147,7 @@ void irq_handler(regs_t *r)
 
 	irq_handler_t handler = NULL;
 
-	if (int_num > 47 || int_num < 32) /* Out of range */
+	if (int_num > 32 + NR_IRQS - 1 || int_num < 32) /* Out of range */
 		handler = NULL;
 	else
 		handler = irq_handlers[int_num - 32];
@@ -147,6 +155,10 @@ void irq_handler(regs_t *r)
     irq_ack(int_num - 32);
 
 	if (handler) handler(r);
+
+	/* The handler woke up a process that outranks the current one */
+	if (need_resched)
+		arch_sched();
 }
 
 
@@ -168,6 +180,7 @@ static void irq_setup_gates(void)
 	idt_set_gate(45, (uint32_t) irq13);
 	idt_set_gate(46, (uint32_t) irq14);
 	idt_set_gate(47, (uint32_t) irq15);
+	idt_set_gate(48, (uint32_t) irq16);
 }
 
 void pic_setup()
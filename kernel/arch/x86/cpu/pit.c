@@ -14,30 +14,10 @@
 #include <cpu/cpu.h>
 #include <cpu/io.h>
 
-static volatile int wait;
-volatile uint32_t pit_freq = 0;
-volatile uint32_t pit_ticks = 0;
-volatile uint32_t pit_sub_ticks = 0;
-
-static void pit_handler(regs_t *r __unused)
-{
-	--wait;
-	++pit_sub_ticks;
-
-	if (pit_sub_ticks == pit_freq) {
-		++pit_ticks;
-		pit_sub_ticks = 0;
-	}
-}
-
-void sleep(uint32_t ms)
-{
-	wait = ms * pit_freq / 1000;
-	while (wait > 0) asm("hlt");
-}
-
 #define PIT_CMD			0x43
 #define PIT_CHANNEL0	0x40
+#define PIT_CHANNEL2	0x42
+#define PIT_GATE2		0x61	/* Channel 2 gate (bit 0) and output (bit 5) */
 
 struct pit_cmd_register {
 	uint32_t bcd	: 1;
@@ -46,24 +26,86 @@ struct pit_cmd_register {
 	uint32_t channel: 2;
 } __packed;
 
+#define PIT_MODE_ONESHOT		0x0	/* Interrupt on terminal count */
 #define PIT_MODE_SQUARE_WAVE	0x3
 #define PIT_ACCESS_LOHIBYTE		0x3
 
-void pit_setup(uint32_t freq)
+#define PIT_MAX_COUNT	0xFFFF
+
+static void pit_program(int channel, int mode, uint32_t count)
 {
 	struct pit_cmd_register cmd = {
 		.bcd = 0,
-		.mode = PIT_MODE_SQUARE_WAVE,
+		.mode = mode,
 		.access = PIT_ACCESS_LOHIBYTE,
-		.channel = 0,
+		.channel = channel,
 	};
 
-	pit_freq = freq;
-	uint32_t div = 1193180/freq;  /* PIT Oscillator operates at 1.193180 MHz */
+	outb(PIT_CMD, cmd);
+	outb(PIT_CHANNEL0 + channel, (count >> 0) & 0xFF);
+	outb(PIT_CHANNEL0 + channel, (count >> 8) & 0xFF);
+}
+
+static inline uint32_t pit_count(uint32_t us)
+{
+	uint32_t count = us * (PIT_HZ / 1000) / 1000;
+	return MIN(MAX(count, 1), PIT_MAX_COUNT);
+}
+
+/* Busy wait on channel 2, does not need interrupts or channel 0 */
+void pit_delay(uint32_t us)
+{
+	/* Gate on, speaker off */
+	outb(PIT_GATE2, (inb(PIT_GATE2) & ~0x02) | 0x01);
+
+	while (us) {
+		uint32_t chunk = MIN(us, pit_clock_event.max_oneshot);
+		pit_program(2, PIT_MODE_ONESHOT, pit_count(chunk));
+		while (!(inb(PIT_GATE2) & 0x20));
+		us -= chunk;
+	}
+}
+
+void sleep(uint32_t ms)
+{
+	pit_delay(ms * 1000);
+}
+
+/* Writing the mode without a count leaves channel 0 idle */
+void pit_stop()
+{
+	struct pit_cmd_register cmd = {
+		.bcd = 0,
+		.mode = PIT_MODE_ONESHOT,
+		.access = PIT_ACCESS_LOHIBYTE,
+		.channel = 0,
+	};
 
 	outb(PIT_CMD, cmd);
-	outb(PIT_CHANNEL0, (div >> 0) & 0xFF);
-	outb(PIT_CHANNEL0, (div >> 8) & 0xFF);
+}
+
+/* ================== Clock Event ================== */
+
+static int pit_probe()
+{
+	return 0;
+}
 
-	irq_install_handler(0, pit_handler);
+static void pit_periodic(uint32_t hz)
+{
+	pit_program(0, PIT_MODE_SQUARE_WAVE, MIN(PIT_HZ / hz, PIT_MAX_COUNT));
 }
+
+static void pit_oneshot(uint32_t us)
+{
+	pit_program(0, PIT_MODE_ONESHOT, pit_count(us));
+}
+
+struct clock_event pit_clock_event = {
+	.name = "pit",
+	.irq = PIT_IRQ,
+	.max_oneshot = 54000,	/* 65535 counts is a bit under 55 ms */
+	.probe = pit_probe,
+	.periodic = pit_periodic,
+	.oneshot = pit_oneshot,
+};
@@ -0,0 +1,110 @@
+/**********************************************************************
+ *                  CMOS Real Time Clock (RTC)
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <cpu/cpu.h>
+#include <cpu/io.h>
+
+#define CMOS_ADDR   0x70
+#define CMOS_DATA   0x71
+
+#define RTC_SEC     0x00
+#define RTC_MIN     0x02
+#define RTC_HOUR    0x04
+#define RTC_DAY     0x07
+#define RTC_MONTH   0x08
+#define RTC_YEAR    0x09
+#define RTC_STATUS_A    0x0A
+#define RTC_STATUS_B    0x0B
+
+#define RTC_UIP     _BV(7)  /* Status A: update in progress */
+#define RTC_24H     _BV(1)  /* Status B: 24 hour mode */
+#define RTC_BINARY  _BV(2)  /* Status B: binary, not BCD */
+#define RTC_PM      _BV(7)  /* Hours register in 12 hour mode */
+
+struct rtc_date {
+    uint8_t sec, min, hour, day, month, year;
+};
+
+static inline uint8_t cmos_read(uint8_t reg)
+{
+    outb(CMOS_ADDR, reg);
+    return inb(CMOS_DATA);
+}
+
+static void rtc_read(struct rtc_date *date)
+{
+    while (cmos_read(RTC_STATUS_A) & RTC_UIP);
+
+    date->sec   = cmos_read(RTC_SEC);
+    date->min   = cmos_read(RTC_MIN);
+    date->hour  = cmos_read(RTC_HOUR);
+    date->day   = cmos_read(RTC_DAY);
+    date->month = cmos_read(RTC_MONTH);
+    date->year  = cmos_read(RTC_YEAR);
+}
+
+static inline int rtc_date_equal(struct rtc_date *a, struct rtc_date *b)
+{
+    return a->sec == b->sec && a->min == b->min && a->hour == b->hour
+        && a->day == b->day && a->month == b->month && a->year == b->year;
+}
+
+static inline uint8_t bcd_to_bin(uint8_t bcd)
+{
+    return (bcd & 0x0F) + (bcd >> 4) * 10;
+}
+
+/* Days since 1970-01-01 of a date in the proleptic Gregorian calendar */
+static uint32_t days_from_civil(uint32_t y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    uint32_t era = y / 400;
+    uint32_t yoe = y - era * 400;
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/* Seconds since the Epoch, the RTC is assumed to keep UTC */
+uint32_t rtc_time()
+{
+    struct rtc_date date, last;
+
+    /* Read until two reads agree, an update could happen in between */
+    rtc_read(&date);
+
+    do {
+        last = date;
+        rtc_read(&date);
+    } while (!rtc_date_equal(&last, &date));
+
+    uint8_t status = cmos_read(RTC_STATUS_B);
+    int pm = !(status & RTC_24H) && (date.hour & RTC_PM);
+
+    date.hour &= ~RTC_PM;
+
+    if (!(status & RTC_BINARY)) {
+        date.sec   = bcd_to_bin(date.sec);
+        date.min   = bcd_to_bin(date.min);
+        date.hour  = bcd_to_bin(date.hour);
+        date.day   = bcd_to_bin(date.day);
+        date.month = bcd_to_bin(date.month);
+        date.year  = bcd_to_bin(date.year);
+    }
+
+    if (!(status & RTC_24H))
+        date.hour = date.hour % 12 + (pm ? 12 : 0);
+
+    /* No reliable century register, two digit years are 2000 and later */
+    uint32_t days = days_from_civil(2000 + date.year, date.month, date.day);
+
+    return days * 86400 + date.hour * 3600 + date.min * 60 + date.sec;
+}
@@ -0,0 +1,52 @@
+/**********************************************************************
+ *                  Time Stamp Counter (TSC)
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <cpu/cpu.h>
+#include <sys/clock.h>
+
+#define TSC_CALIBRATE_MS    10
+#define TSC_SHIFT           22  /* Keeps the mult in 32 bits down to 1 MHz */
+
+uint32_t tsc_khz = 0;
+
+static uint64_t tsc_read()
+{
+    return read_tsc();
+}
+
+struct clock_source tsc_clock_source = {
+    .name  = "tsc",
+    .read  = tsc_read,
+    .shift = TSC_SHIFT,
+};
+
+/* Count TSC cycles over a delay timed by the PIT */
+void tsc_calibrate()
+{
+    struct cpu_features features;
+    get_cpu_features(&features);
+
+    if (!features.tsc)
+        return;
+
+    uint64_t start = read_tsc();
+    pit_delay(TSC_CALIBRATE_MS * 1000);
+    tsc_khz = div_u64_u32(read_tsc() - start, TSC_CALIBRATE_MS);
+
+    if (tsc_khz < 1000) {  /* Too slow to be of any use */
+        tsc_khz = 0;
+        return;
+    }
+
+    tsc_clock_source.mult = div_u64_u32((uint64_t) 1000000 << TSC_SHIFT, tsc_khz);
+
+    printk("[0] Kernel: TSC -> %d MHz\n", tsc_khz / 1000);
+}
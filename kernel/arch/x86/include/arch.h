@@ -12,9 +12,9 @@ typedef struct
 	uintptr_t	pd; /* Page Directory */
 
 	uintptr_t	kstack;	/* Kernel stack */
-	uintptr_t	eip;
+	uintptr_t	kesp;	/* Saved kernel stack pointer, see x86_switch_to */
+	uintptr_t	eip;	/* User entry point and stack if not spawned */
 	uintptr_t	esp;
-	uintptr_t	ebp;
 	uintptr_t	eflags;
 	uintptr_t	eax;	/* For syscall return if process is not spawned */
 	regs_t		*regs;	/* Pointer to registers on the stack */
@@ -25,6 +25,28 @@ typedef struct
     int fpu_enabled : 1;
 } __attribute__((packed)) x86_proc_t;
 
+/* Callee-saved registers pushed by x86_switch_to, lowest address first */
+struct x86_switch_frame
+{
+	uintptr_t	edi;
+	uintptr_t	esi;
+	uintptr_t	ebx;
+	uintptr_t	ebp;
+	uintptr_t	eip;	/* x86_switch_to returns here */
+};
+
+/* arch/x86/cpu/sys.S */
+void x86_switch_to(uintptr_t *prev_esp, uintptr_t next_esp);
+
+/* arch/x86/sys/proc.c */
+struct kmem_cache;
+extern struct kmem_cache x86_proc_cache;
+uintptr_t x86_switch_frame_init(uintptr_t stack, void (*entry)());
+void x86_switch_done();
+
 void arch_syscall(regs_t *r);
 
+/* arch/x86/sys/sched.c */
+extern uintptr_t x86_idle_esp;
+
 #endif /* ! _X86_ARCH_H */
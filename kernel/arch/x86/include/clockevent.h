@@ -0,0 +1,32 @@
+#ifndef _X86_CLOCKEVENT_H
+#define _X86_CLOCKEVENT_H
+
+#include <core/system.h>
+
+/*
+ *  A clock event device raises the timer interrupt, periodically or once
+ *  after a given delay. Devices without a periodic mode get it emulated by
+ *  re-arming a one-shot on every interrupt.
+ */
+
+struct clock_event {
+    const char *name;
+    unsigned irq;
+    uint32_t max_oneshot;   /* Longest one-shot delay in microseconds */
+
+    int  (*probe)();    /* Returns 0 if the device is usable */
+    void (*periodic)(uint32_t hz);
+    void (*oneshot)(uint32_t us);
+};
+
+extern struct clock_event pit_clock_event;
+extern struct clock_event lapic_clock_event;
+extern struct clock_event tsc_deadline_clock_event;
+
+extern struct clock_event *clock_event;
+
+void clock_event_setup(irq_handler_t handler);
+void clock_event_periodic(uint32_t hz);
+void clock_event_oneshot(uint32_t us);
+
+#endif /* ! _X86_CLOCKEVENT_H */
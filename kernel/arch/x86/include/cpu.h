@@ -72,9 +72,11 @@ struct cpu {
 #define CR0_MP  _BV(1)
 #define CR0_EM  _BV(2)
 #define CR0_NE  _BV(5)
+#define CR0_WP  _BV(16)
 
 /* CR4 */
 #define CR4_PSE _BV(4)
+#define CR4_PGE _BV(7)
 
 /* CPU function */
 static inline uint32_t read_cr0()
@@ -189,19 +191,29 @@ void gdt_setup();
 void idt_setup();
 void idt_set_gate(uint32_t id, uint32_t offset);
 void idt_set_gate_user(uint32_t id, uint32_t offset);
+void idt_set_task_gate(uint32_t id, uint16_t selector);
 void isr_setup();
+void df_setup();
 void pic_setup();
 void pic_disable();
-void pit_setup(uint32_t);
 void set_tss_esp(uint32_t esp);
+void set_df_task(uintptr_t eip, uintptr_t esp);
+
+#define DF_TSS_SELECTOR (0x30)
 void set_kernel_stack(uintptr_t esp);
 void enable_fpu();
 void disable_fpu();
+struct proc;
+void switch_fpu(struct proc *proc);
 void trap_fpu();
 
 #include "msr.h"
 #include "sdt.h"
 #include "irq.h"
 #include "pit.h"
+#include "tsc.h"
+#include "rtc.h"
+#include "lapic.h"
+#include "clockevent.h"
 
 #endif /* !_X86_CPU_H */
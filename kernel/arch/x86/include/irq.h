@@ -7,5 +7,8 @@ typedef void (*irq_handler_t)(regs_t *);
 void irq_install_handler(unsigned irq, irq_handler_t handler);
 
 #define PIT_IRQ	0
+#define LAPIC_TIMER_IRQ	16	/* Not a PIC line, vector 48 from the local APIC */
+
+#define NR_IRQS	17
 
 #endif /* !_X86_IRQ_H */
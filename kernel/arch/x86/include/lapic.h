@@ -0,0 +1,28 @@
+#ifndef _X86_LAPIC_H
+#define _X86_LAPIC_H
+
+#include <core/system.h>
+
+/* Register offsets from the LAPIC base */
+#define LAPIC_EOI           0x0B0
+#define LAPIC_SVR           0x0F0
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_TIMER_ICR     0x380   /* Initial count */
+#define LAPIC_TIMER_CCR     0x390   /* Current count */
+#define LAPIC_TIMER_DCR     0x3E0   /* Divide configuration */
+
+#define LAPIC_SVR_ENABLE    _BV(8)
+
+#define LAPIC_LVT_MASKED            _BV(16)
+#define LAPIC_TIMER_PERIODIC        _BV(17)
+#define LAPIC_TIMER_TSC_DEADLINE    _BV(18)
+
+#define LAPIC_TIMER_DIV16   0x3
+
+#define LAPIC_TIMER_VECTOR      48
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+
+int  lapic_setup();
+void lapic_eoi();
+
+#endif /* ! _X86_LAPIC_H */
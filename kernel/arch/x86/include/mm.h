@@ -6,6 +6,19 @@
 #define NR_PAGE_SIZE	2
 #define KERNEL_HEAP_SIZE	(8 * 1024  * 1024)	/* 8 MiB */
 
+#define SLAB_BASE	(0xE0000000UL)
+#define SLAB_SIZE	(0x10000000UL)	/* 256 MiB */
+
+/* Low physical memory is mapped linearly up to the framebuffer window */
+#define DIRECT_MAP_BASE	(0xC0000000UL)
+#define DIRECT_MAP_SIZE	(0x0A000000UL)	/* 160 MiB */
+
+#define VMALLOC_BASE	(0xF0000000UL)
+#define VMALLOC_END	(0xFF000000UL)
+
+#define LAPIC_VIRT	(0xFF000000UL)	/* Local APIC registers */
+#define CLOCK_PAGE	(0xFF400000UL)	/* Clock data, readable from userland */
+
 extern char _VMA; /* Must be defined in linker script */
 #define VMA(obj)  ((typeof((obj)))((uintptr_t)(void*)&_VMA + (uintptr_t)(void*)(obj)))
 #define LMA(obj)  ((typeof((obj)))((uintptr_t)(void*)(obj)) - (uintptr_t)(void*)&_VMA)
@@ -23,5 +36,15 @@ void kfree(void*);
 uintptr_t arch_get_frame();
 uintptr_t arch_get_frame_no_clr();
 void arch_release_frame(uintptr_t);
+void arch_page_ref(uintptr_t);
+void arch_page_unref(uintptr_t);
+void *arch_kmap(uintptr_t);
+void arch_kunmap(void *);
+uintptr_t arch_new_page_directory();
+void arch_free_page_directory(uintptr_t);
+int arch_prezero_frame();
+void arch_tlb_batch_begin();
+void arch_tlb_batch_end();
+void vmm_reclaim();
 
 #endif /* !_X86_MM_H */
@@ -18,5 +18,7 @@ static inline void msr_write(uint32_t msr, uint64_t val)
 }
 
 #define APIC_BASE	0x1B
+#define IA32_PAT	0x277
+#define IA32_TSC_DEADLINE	0x6E0
 
 #endif /* !_X86_MSR_H */
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <core/system.h>
 
-void pit_setup(uint32_t freq);
+#define PIT_HZ  1193182     /* PIT oscillator frequency */
+
+void pit_delay(uint32_t us);
+void pit_stop();
 
 #endif /* ! _X86_PIT_H */
@@ -0,0 +1,8 @@
+#ifndef _X86_RTC_H
+#define _X86_RTC_H
+
+#include <core/system.h>
+
+uint32_t rtc_time();
+
+#endif /* ! _X86_RTC_H */
@@ -0,0 +1,28 @@
+#ifndef _X86_TSC_H
+#define _X86_TSC_H
+
+#include <core/system.h>
+
+extern uint32_t tsc_khz;    /* 0 if there is no usable TSC */
+
+static inline uint64_t read_tsc()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc":"=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+/* 64 by 32 bit division, the quotient must fit in 32 bits */
+static inline uint32_t div_u64_u32(uint64_t n, uint32_t d)
+{
+    uint32_t q, r;
+    asm("divl %4":"=a"(q), "=d"(r):"a"((uint32_t) n), "d"((uint32_t) (n >> 32)), "rm"(d));
+    return q;
+}
+
+struct clock_source;
+extern struct clock_source tsc_clock_source;
+
+void tsc_calibrate();
+
+#endif /* ! _X86_TSC_H */
@@ -20,9 +20,15 @@
 #include <core/arch.h>
 #include <cpu/cpu.h>
 #include <ds/queue.h>
+#include <ds/buddy.h>
 #include <mm/buddy.h>
+#include <mm/frame_cache.h>
+#include <mm/meminfo.h>
+#include <mm/vma.h>
+#include <mm/page_cache.h>
 #include <sys/proc.h>
 #include <sys/sched.h>
+#include <sys/signal.h>
 
 #include "32_bit.h"
 
@@ -34,52 +40,226 @@ static inline void tlb_invalidate_page(uintptr_t virt)
     asm("invlpg (%%eax)"::"a"(virt));
 }
 
-#define MOUNT_ADDR ((void *) 0xFFBFF000)
+/*
+ *  Kernel mappings are marked global when PGE is supported so they survive
+ *  the CR3 reload on address space switches, flushing them requires
+ *  toggling CR4.PGE instead
+ */
+
+static int pge_enabled = 0;
+
+#define IS_KERNEL_PDE(pdidx) ((pdidx) >= 768)
+
+static inline void tlb_flush_global()
+{
+    if (pge_enabled) {
+        uint32_t cr4 = read_cr4();
+        write_cr4(cr4 & ~CR4_PGE);
+        write_cr4(cr4);
+    } else {
+        TLB_flush();
+    }
+}
+
+/*
+ *  Invalidations after unmapping (or write protecting) can be gathered in a
+ *  batch and done at its end. A few pages are invalidated one by one, past
+ *  TLB_BATCH_MAX pages, or once a whole table is gone, a full flush is
+ *  cheaper. A page that was not present can't be in the TLB, so mapping one
+ *  needs no invalidation, unless its unmap is still pending in a batch.
+ */
+
+#define TLB_BATCH_MAX       32
+
+#define TLB_DIRTY_USER      _BV(0)
+#define TLB_DIRTY_GLOBAL    _BV(1)
+
+static int tlb_batch_depth = 0;
+static int tlb_batch_dirty = 0;
+static int tlb_batch_full  = 0;    /* Too much to invalidate page by page */
+static size_t tlb_batch_nr = 0;
+static uintptr_t tlb_batch_pages[TLB_BATCH_MAX];
+
+static inline int tlb_dirty_flag(size_t pdidx)
+{
+    return IS_KERNEL_PDE(pdidx) ? TLB_DIRTY_GLOBAL : TLB_DIRTY_USER;
+}
+
+/*
+ *  Other CPUs running on the same mappings have to drop them as well, `nr'
+ *  of 0 means a full flush. Nothing to do until SMP is up.
+ */
+static inline void tlb_shootdown(int dirty, uintptr_t *pages, size_t nr)
+{
+    /* FIXME: Send an invalidation IPI to other CPUs */
+    (void) dirty; (void) pages; (void) nr;
+}
+
+static inline void tlb_flush_dirty(int dirty)
+{
+    if (dirty & TLB_DIRTY_GLOBAL)
+        tlb_flush_global();
+    else
+        TLB_flush();
+
+    tlb_shootdown(dirty, NULL, 0);
+}
+
+static inline void tlb_unmap_page(uintptr_t virt)
+{
+    int dirty = tlb_dirty_flag(virt / TABLE_SIZE);
+
+    if (!tlb_batch_depth) {
+        tlb_invalidate_page(virt);
+        tlb_shootdown(dirty, &virt, 1);
+        return;
+    }
+
+    tlb_batch_dirty |= dirty;
+
+    if (tlb_batch_nr == TLB_BATCH_MAX)
+        tlb_batch_full = 1;
+    else if (!tlb_batch_full)
+        tlb_batch_pages[tlb_batch_nr++] = virt;
+}
+
+static inline void tlb_unmap_table(size_t pdidx)
+{
+    int dirty = tlb_dirty_flag(pdidx);
+
+    if (tlb_batch_depth) {
+        tlb_batch_dirty |= dirty;
+        tlb_batch_full = 1;
+    } else {
+        tlb_flush_dirty(dirty);
+    }
+}
+
+static inline void tlb_map_page(uintptr_t virt)
+{
+    if (tlb_batch_dirty)
+        tlb_invalidate_page(virt);
+}
+
 #define PAGE_DIR ((__table_t *) 0xFFFFF000)
 #define PAGE_TBL(i) ((__page_t *) (0xFFC00000 + 0x1000 * i))
 
 /* ================== Frame Helpers ================== */
 
-static inline uintptr_t frame_mount(uintptr_t paddr)
-{
-    //printk("mount_page(%p)\n", paddr);
-    if (!paddr)
-        return (uintptr_t) last_page_table[1023].raw & ~PAGE_MASK;
+/*
+ *  Low physical memory is permanently mapped at the start of the kernel
+ *  half, frames above it are mapped on demand in a small set of per-CPU
+ *  temporary slots at the end of the last page table. Slots are handed
+ *  out as a stack, kunmap must be called in reverse order of kmap.
+ */
+
+#define KMAP_CPUS       (32)
+#define KMAP_SLOTS      (8)     /* Slots per CPU */
+#define KMAP_FIRST      (1024 - KMAP_CPUS * KMAP_SLOTS)
+#define KMAP_ADDR(slot) (0xFF800000 + (KMAP_FIRST + (slot)) * PAGE_SIZE)
+
+static uintptr_t lowmem_end = 0;    /* End of direct mapped physical memory */
+static size_t kmap_depth[KMAP_CPUS];
 
+#define PHYS_TO_VIRT(paddr)     ((void *) ((paddr) + DIRECT_MAP_BASE))
+#define IS_LOWMEM(paddr, size)  ((paddr) + (size) <= lowmem_end)
+
+static inline void *kmap(uintptr_t paddr)
+{
     if (paddr & PAGE_MASK)
-        panic("Mount must be on page (4K) boundary");
+        panic("kmap must be on page (4K) boundary");
+
+    if (IS_LOWMEM(paddr, PAGE_SIZE))
+        return PHYS_TO_VIRT(paddr);
+
+    /* FIXME: Use the current CPU id once SMP is up */
+    size_t cpu = 0;
 
-    uintptr_t prev = (uintptr_t) last_page_table[1023].raw & ~PAGE_MASK;
+    if (kmap_depth[cpu] == KMAP_SLOTS)
+        panic("Out of kmap slots");
 
-    __page_t page;
-    page.raw = paddr;
+    size_t slot = cpu * KMAP_SLOTS + kmap_depth[cpu]++;
+
+    __page_t page = {.raw = paddr};
     page.structure.present = 1;
     page.structure.write = 1;
 
-    last_page_table[1023] = page;
-    tlb_invalidate_page((uintptr_t) MOUNT_ADDR);
+    last_page_table[KMAP_FIRST + slot] = page;
+    tlb_invalidate_page(KMAP_ADDR(slot));
+
+    return (void *) KMAP_ADDR(slot);
+}
+
+static inline void kunmap(void *addr)
+{
+    if ((uintptr_t) addr < KMAP_ADDR(0))   /* Direct mapped */
+        return;
+
+    size_t cpu = 0;
+    --kmap_depth[cpu];
+
+    /* Stale entry is invalidated when the slot is reused */
+    last_page_table[KMAP_FIRST + cpu * KMAP_SLOTS + kmap_depth[cpu]].raw = 0;
+}
+
+/*
+ *  Frames known to contain only zeros, the idle loop keeps a pool of them
+ *  topped up so that allocations needing cleared memory can skip the memset
+ */
+
+#define ZERO_POOL_SIZE  (256)
+
+static uintptr_t zero_pool[ZERO_POOL_SIZE];
+static size_t zero_pool_count = 0;
+
+static inline uintptr_t zero_pool_get()
+{
+    if (!zero_pool_count)
+        return 0;
+
+    return zero_pool[--zero_pool_count];
+}
+
+/* Get a free frame, reclaiming lazily released kernel heap under pressure */
+static inline uintptr_t frame_alloc()
+{
+    uintptr_t frame = frame_cache_alloc();
+
+    if (!frame) {
+        vmm_reclaim();
+        frame = frame_cache_alloc();
+    }
 
-    return prev;
-} 
+    return frame;
+}
 
 static inline uintptr_t frame_get()
 {
-    uintptr_t frame = buddy_alloc(PAGE_SIZE);
+    uintptr_t frame = zero_pool_get();
+
+    if (frame)
+        return frame;
+
+    frame = frame_alloc();
 
     if (!frame) {
         panic("Could not allocate frame");
     }
 
-    uintptr_t old = frame_mount(frame);
-    memset(MOUNT_ADDR, 0, PAGE_SIZE);
-    frame_mount(old);
+    void *p = kmap(frame);
+    memset(p, 0, PAGE_SIZE);
+    kunmap(p);
 
     return frame;
 }
 
 static inline uintptr_t frame_get_no_clr()
 {
-    uintptr_t frame = buddy_alloc(PAGE_SIZE);
+    uintptr_t frame = frame_alloc();
+
+    /* Out of memory? Fall back to zeroed frames */
+    if (!frame)
+        frame = zero_pool_get();
 
     if (!frame) {
         panic("Could not allocate frame");
@@ -90,9 +270,236 @@ static inline uintptr_t frame_get_no_clr()
 
 static void frame_release(uintptr_t i)
 {
-    /* Release frame if it is mapped */
-    if (i & 0x1)
-        buddy_free(i, PAGE_SIZE);
+    frame_cache_free(i & ~PAGE_MASK, 0);
+}
+
+/* Clear one free frame and add it to the zero pool, called when idle */
+static int zero_pool_fill()
+{
+    if (zero_pool_count == ZERO_POOL_SIZE)
+        return 0;
+
+    /* Take it from the buddy system, hot frames in the cache are better
+     * left for allocations that are going to be written right away */
+    uintptr_t frame = buddy_alloc(PAGE_SIZE);
+
+    if (!frame)
+        return 0;
+
+    void *p = kmap(frame);
+    memset(p, 0, PAGE_SIZE);
+    kunmap(p);
+
+    zero_pool[zero_pool_count++] = frame;
+
+    return 1;
+}
+
+/* ================== Page Directories ================== */
+
+/*
+ *  Every process owns a page directory. The kernel half (everything from
+ *  PDE 768 up to the mount window) is the same in all of them, the
+ *  bootstrap directory holds the reference copy and changes to it are
+ *  pushed to every other directory. The last entry maps each directory
+ *  onto itself.
+ */
+
+static queue_t *page_directories = NEW_QUEUE;
+static size_t nr_page_tables = 0;
+static uintptr_t cur_pd = 0;
+
+static inline void directory_set(size_t pdidx, __table_t table)
+{
+    if (!IS_KERNEL_PDE(pdidx)) {
+        PAGE_DIR[pdidx] = table;
+        return;
+    }
+
+    bootstrap_processor_table[pdidx] = table;
+
+    forlinked (node, page_directories->head, node->next) {
+        __table_t *dir = kmap((uintptr_t) node->value);
+        dir[pdidx] = table;
+        kunmap(dir);
+    }
+}
+
+/* ================== Shared Page Tables ================== */
+
+/*
+ *  fork shares user page tables instead of copying them: both directories
+ *  point at the same table, the PDE is write-protected and the table frame
+ *  is refcounted in pages[] like any other page. The first change to a
+ *  shared table from either side gives that side a private copy (see
+ *  table_unshare), from there on pages are copy-on-write as usual.
+ */
+
+#define IS_TABLE_SHARED(pdidx) (!IS_KERNEL_PDE(pdidx) \
+    && PAGE_DIR[pdidx].structure.present && !PAGE_DIR[pdidx].structure.write)
+
+/* Drop a reference to a user table, the last one releases it and its pages */
+static void table_put(uintptr_t table)
+{
+    size_t table_idx = table/PAGE_SIZE;
+
+    if (pages[table_idx].refs > 1) {
+        pages[table_idx].refs--;
+        return;
+    }
+
+    __page_t *page_table = kmap(table);
+
+    for (size_t j = 0; j < 1024; ++j) {
+        if (page_table[j].structure.present && !page_table[j].structure.io) {
+            size_t page_idx = page_table[j].raw/PAGE_SIZE;
+
+            if (pages[page_idx].refs == 1)
+                frame_release(page_table[j].raw & ~PAGE_MASK);
+
+            pages[page_idx].refs--;
+        }
+    }
+
+    kunmap(page_table);
+
+    pages[table_idx].refs = 0;
+    frame_release(table);
+    --nr_page_tables;
+}
+
+/* Make the user table at `pdidx' private and writable */
+static void table_unshare(size_t pdidx)
+{
+    __table_t pde = PAGE_DIR[pdidx];
+    uintptr_t table = GET_PHYS_ADDR(&pde);
+
+    if (pages[table/PAGE_SIZE].refs > 1) {
+        uintptr_t copy = frame_get_no_clr();
+
+        /* Not through PAGE_TBL(pdidx), the read-only PDE makes that window
+         * read-only as well */
+        __page_t *src = kmap(table);
+        __page_t *dst = kmap(copy);
+
+        for (size_t j = 0; j < 1024; ++j) {
+            if (src[j].structure.present && !src[j].structure.io) {
+                /* Both tables map the page now, writes have to copy it */
+                if (!src[j].structure.shared)
+                    src[j].structure.write = 0;
+
+                pages[src[j].raw/PAGE_SIZE].refs++;
+            }
+
+            dst[j] = src[j];
+        }
+
+        kunmap(dst);
+        kunmap(src);
+
+        pages[table/PAGE_SIZE].refs--;
+        pages[copy/PAGE_SIZE].refs = 1;
+        ++nr_page_tables;
+
+        pde.raw = copy | (pde.raw & PAGE_MASK);
+    }
+
+    pde.structure.write = 1;
+    directory_set(pdidx, pde);
+    TLB_flush();
+}
+
+static uintptr_t directory_new()
+{
+    uintptr_t pd = frame_get();
+    __table_t *dir = kmap(pd);
+
+    for (size_t i = 768; i < 1023; ++i)
+        dir[i] = bootstrap_processor_table[i];
+
+    dir[1023].raw = pd;
+    dir[1023].structure.write = 1;
+    dir[1023].structure.present = 1;
+
+    kunmap(dir);
+
+    enqueue(page_directories, (void *) pd);
+    ++nr_page_tables;
+
+    return pd;
+}
+
+/* Release a page directory and whatever is still mapped in its user half */
+static void directory_free(uintptr_t pd)
+{
+    if (pd == cur_pd)
+        panic("Freeing the current page directory");
+
+    queue_remove(page_directories, (void *) pd);
+
+    __table_t *dir = kmap(pd);
+
+    for (size_t i = 0; i < 768; ++i) {
+        if (dir[i].structure.present)
+            table_put(GET_PHYS_ADDR(&dir[i]));
+    }
+
+    kunmap(dir);
+
+    frame_release(pd);
+    --nr_page_tables;
+}
+
+/* ================== Page Attribute Table ================== */
+
+/*
+ *  The memory type of a mapping is picked from the PAT by its PAT, PCD and
+ *  PWT bits. Entries 0-3 keep their power-on values (WB, WT, UC-, UC) so
+ *  existing mappings are unaffected, entry 4 (PAT bit only) becomes WC.
+ */
+
+static int pat_enabled = 0;
+
+#define PAT_VALUE   0x0007040100070406ULL
+#define PDE_PAT     _BV(12)     /* PAT bit of a 4 MiB page */
+
+/* ================== Huge Pages ================== */
+
+/*
+ *  With PSE a directory entry can map a 4 MiB page directly. We only use
+ *  them for kernel mappings of memory we don't own (the kernel image and
+ *  MMIO), they are never refcounted and are torn down as a whole.
+ */
+
+static int pse_enabled = 0;
+
+#define IS_HUGE(pdidx) \
+    (PAGE_DIR[pdidx].structure.present && PAGE_DIR[pdidx].structure.page_size)
+
+static inline void huge_page_map(uintptr_t paddr, size_t pdidx, int flags)
+{
+    if (pdidx > 1021)
+        panic("Invlaid PDE");
+
+    __table_t table = {.raw = paddr};
+
+    table.structure.present = 1;
+    table.structure.write = !!(flags & (KW | UW));
+    table.structure.page_size = 1;
+    table.structure.global = pge_enabled;
+
+    if (pat_enabled && (flags & MWC))
+        table.raw |= PDE_PAT;
+
+    directory_set(pdidx, table);
+    tlb_invalidate_page(pdidx * TABLE_SIZE);
+}
+
+static inline int huge_page_fits(uintptr_t paddr, uintptr_t virt, size_t nr, int flags)
+{
+    return pse_enabled && !(flags & URWX) && nr >= TABLE_SIZE/PAGE_SIZE
+        && !(paddr & TABLE_MASK) && !(virt & TABLE_MASK)
+        && !PAGE_DIR[virt/TABLE_SIZE].structure.present;
 }
 
 /* ================== Page Helpers ================== */
@@ -106,12 +513,20 @@ static inline void table_alloc(size_t pdidx, int flags)
 
     __table_t table = {.raw = frame_get()};
 
+    /* Permissions are enforced per page, tables allow everything */
     table.structure.present = 1;
-    table.structure.write = !!(flags & (KW | UW));
+    table.structure.write = 1;
     table.structure.user = !!(flags & (URWX));
 
-    PAGE_DIR[pdidx] = table;
-    TLB_flush();
+    /* User tables are refcounted, they can be shared by fork */
+    if (!IS_KERNEL_PDE(pdidx))
+        pages[table.raw/PAGE_SIZE].refs = 1;
+
+    directory_set(pdidx, table);
+    ++nr_page_tables;
+
+    /* The recursive mapping of a table dropped in this batch may be cached */
+    tlb_map_page((uintptr_t) PAGE_TBL(pdidx));
 }
 
 static inline void table_dealloc(size_t pdidx)
@@ -121,12 +536,21 @@ static inline void table_dealloc(size_t pdidx)
     if (pdidx > 1023)
         panic("Invlaid PDE");
 
-    if (PAGE_DIR[pdidx].structure.present) {
-        PAGE_DIR[pdidx].structure.present = 0;
-        frame_release(PAGE_DIR[pdidx].raw & ~PAGE_MASK);
+    __table_t table = PAGE_DIR[pdidx];
+
+    if (table.structure.present) {
+        directory_set(pdidx, (__table_t) {.raw = 0});
+
+        if (!IS_KERNEL_PDE(pdidx)) {
+            /* Releases whatever is still mapped, unless someone shares it */
+            table_put(GET_PHYS_ADDR(&table));
+        } else if (!table.structure.page_size) {    /* No table behind a huge page */
+            frame_release(table.raw & ~PAGE_MASK);
+            --nr_page_tables;
+        }
     }
 
-    TLB_flush();
+    tlb_unmap_table(pdidx);
 }
 
 /* ================== Page Helpers ================== */
@@ -144,14 +568,23 @@ static inline void page_map_phys(uintptr_t paddr, size_t pdidx, size_t ptidx, in
     page.structure.present = 1;
     page.structure.write = !!(flags & (KW | UW));
     page.structure.user = !!(flags & (URWX));
+    page.structure.global = pge_enabled && IS_KERNEL_PDE(pdidx);
+    page.structure.memory_type = pat_enabled && (flags & MWC);
+    page.structure.page_level_cache_disable = !!(flags & MUC);
+    page.structure.page_level_write_through = !!(flags & MUC);
+
+    /* I/O memory has no frame to refcount, it is never copy-on-write */
+    page.structure.io = page.structure.shared = !!(flags & MIO);
 
     page_table[ptidx] = page;
 }
 
-static inline void page_alloc(size_t pdidx, size_t ptidx, int flags)
+static inline void page_alloc(size_t pdidx, size_t ptidx, int flags, int zero)
 {
-    /* Get new frame */
-    uintptr_t paddr = frame_get_no_clr();
+    /* Get new frame, frame_get clears it through kmap if it is not from the
+     * zero pool, the page itself may well be mapped read-only */
+    uintptr_t paddr = zero ? frame_get() : frame_get_no_clr();
+
     /* Map page to physical address */
     page_map_phys(paddr, pdidx, ptidx, flags);
     /* Increment references count to physical page */
@@ -164,12 +597,15 @@ static inline void page_dealloc(size_t pdidx, size_t ptidx)
     if (pdidx > 1023 || ptidx > 1023)
         panic("Invlaid PDE or PTE");
 
-    if (PAGE_DIR[pdidx].structure.present) {
+    if (PAGE_DIR[pdidx].structure.present && !PAGE_DIR[pdidx].structure.page_size) {
         __page_t *page_table = PAGE_TBL(pdidx);
         __page_t page = page_table[ptidx];
 
         if (page.structure.present) {
-            page.structure.present = 0;
+            page_table[ptidx].raw = 0;
+
+            if (page.structure.io)
+                return;
 
             size_t page_idx = page.raw/PAGE_SIZE;
 
@@ -190,15 +626,26 @@ static inline void page_map_phys_to_virt(uintptr_t phys, uintptr_t virt, int fla
     size_t pdidx = virtaddr.structure.directory;
     size_t ptidx = virtaddr.structure.table;
 
+    if (IS_HUGE(pdidx))
+        panic("Mapping over a huge page");
+
     if (!PAGE_DIR[pdidx].structure.present) {
         table_alloc(pdidx, flags);
+    } else if (IS_TABLE_SHARED(pdidx)) {
+        table_unshare(pdidx);
     }
 
+    int remap = PAGE_TBL(pdidx)[ptidx].structure.present;
+
     page_map_phys(phys, pdidx, ptidx, flags);
-    tlb_invalidate_page(virt);
+
+    if (remap)  /* The old translation must be gone before we return */
+        tlb_invalidate_page(virt);
+    else
+        tlb_map_page(virt);
 }
 
-static inline void page_map(uintptr_t virt, int flags)
+static inline void page_map(uintptr_t virt, int flags, int zero)
 {
     if (virt & PAGE_MASK)
         panic("Invalid Virtual address");
@@ -207,6 +654,9 @@ static inline void page_map(uintptr_t virt, int flags)
     size_t pdidx = virtaddr.structure.directory;
     size_t ptidx = virtaddr.structure.table;
 
+    if (IS_HUGE(pdidx)) /* Already mapped */
+        return;
+
     if (!PAGE_DIR[pdidx].structure.present) {
         table_alloc(pdidx, flags);
     }
@@ -214,10 +664,12 @@ static inline void page_map(uintptr_t virt, int flags)
     __page_t *page_table = PAGE_TBL(pdidx);
 
     if (!page_table[ptidx].structure.present) {
-        page_alloc(pdidx, ptidx, flags);
-    }
+        if (IS_TABLE_SHARED(pdidx))
+            table_unshare(pdidx);
 
-    tlb_invalidate_page(virt);
+        page_alloc(pdidx, ptidx, flags, zero);
+        tlb_map_page(virt);
+    }
 }
 
 static inline void page_unmap(uintptr_t virt)
@@ -231,14 +683,25 @@ static inline void page_unmap(uintptr_t virt)
     size_t pdidx = virtaddr.structure.directory;
     size_t ptidx = virtaddr.structure.table;
 
+    if (IS_HUGE(pdidx)) {
+        if (ptidx)
+            panic("Partial unmap of a huge page");
+
+        table_dealloc(pdidx);
+        return;
+    }
+
     if (PAGE_DIR[pdidx].structure.present) {
         __page_t *page_table = PAGE_TBL(pdidx);
 
         if (page_table[ptidx].structure.present) {
+            if (IS_TABLE_SHARED(pdidx))
+                table_unshare(pdidx);
+
             page_dealloc(pdidx, ptidx);
         }
 
-        tlb_invalidate_page(virt);
+        tlb_unmap_page(virt);
     }
 }
 
@@ -246,6 +709,10 @@ static inline __page_t *page_get_mapping(uintptr_t addr)
 {
     __virtaddr_t virt = (__virtaddr_t){.raw = addr};
 
+    /* Huge pages have no page table entry */
+    if (IS_HUGE(virt.structure.directory))
+        return NULL;
+
     if (PAGE_DIR[virt.structure.directory].structure.present) {
         __page_t *page = &PAGE_TBL(virt.structure.directory)[virt.structure.table];
 
@@ -264,113 +731,87 @@ static inline __page_t *page_get_mapping(uintptr_t addr)
  *  Note: n is count of bytes not pages
  */
 
-static char page_buffer[PAGE_SIZE];
 static void *copy_physical_to_physical(uintptr_t _phys_dest, uintptr_t _phys_src, size_t n)
 {
-    printk("copy_physical_to_physical(%p, %p, %d)\n", _phys_dest, _phys_src, n);
-
     if (_phys_dest & PAGE_MASK || _phys_src & PAGE_MASK)
         panic("Copy must be on page (4K) boundaries\n");
 
-    char *phys_dest = (char *) _phys_dest;
-    char *phys_src  = (char *) _phys_src;
-    void *ret = phys_dest;
-    uintptr_t prev_mount = frame_mount(0);
-
-    /* Copy full pages */
-    char *p = MOUNT_ADDR;
-    size_t size = n / PAGE_SIZE;
-    while (size--) {
-        frame_mount((uintptr_t) phys_src);
-        memcpy(page_buffer, p, PAGE_SIZE);
-        frame_mount((uintptr_t) phys_dest);
-        memcpy(p, page_buffer, PAGE_SIZE);
-        phys_src += PAGE_SIZE;
-        phys_dest += PAGE_SIZE;
+    if (IS_LOWMEM(_phys_dest, n) && IS_LOWMEM(_phys_src, n)) {
+        memcpy(PHYS_TO_VIRT(_phys_dest), PHYS_TO_VIRT(_phys_src), n);
+        return (void *) _phys_dest;
     }
 
-    /* Copy what is remainig */
-    size = n % PAGE_SIZE;
-    frame_mount((uintptr_t) phys_src);
-    memcpy(page_buffer, p, size);
+    uintptr_t phys_dest = _phys_dest;
+    uintptr_t phys_src  = _phys_src;
+
+    while (n) {
+        size_t size = MIN(n, PAGE_SIZE);
+        char *dest = kmap(phys_dest);
+        char *src  = kmap(phys_src);
 
-    frame_mount((uintptr_t) phys_dest);
-    memcpy(p, page_buffer, size);
+        memcpy(dest, src, size);
 
-    frame_mount(prev_mount);
-    return ret;
+        kunmap(src);
+        kunmap(dest);
+
+        phys_src  += PAGE_SIZE;
+        phys_dest += PAGE_SIZE;
+        n -= size;
+    }
+
+    return (void *) _phys_dest;
 }
 
 static void *copy_physical_to_virtual(void *_virt_dest, void *_phys_src, size_t n)
 {
     char *virt_dest = (char *) _virt_dest;
-    char *phys_src  = (char *) _phys_src;
+    uintptr_t phys_src = (uintptr_t) _phys_src;
+
+    if (IS_LOWMEM(phys_src, n)) {
+        memcpy(virt_dest, PHYS_TO_VIRT(phys_src), n);
+        return _virt_dest;
+    }
 
-    void *ret = virt_dest;
+    while (n) {
+        size_t offset = phys_src & PAGE_MASK;
+        size_t size = MIN(n, PAGE_SIZE - offset);
 
-    /* Copy up to page boundary */
-    size_t offset = (uintptr_t) phys_src % PAGE_SIZE;
-    size_t size = MIN(n, PAGE_SIZE - offset);
-    
-    if (size) {
-        uintptr_t prev_mount = frame_mount((uintptr_t) phys_src);
-        char *p = MOUNT_ADDR;
+        char *p = kmap(phys_src - offset);
         memcpy(virt_dest, p + offset, size);
-        
+        kunmap(p);
+
         phys_src  += size;
         virt_dest += size;
-
-        /* Copy complete pages */
         n -= size;
-        size = n / PAGE_SIZE;
-        while (size--) {
-            frame_mount((uintptr_t) phys_src);
-            memcpy(virt_dest, p, PAGE_SIZE);
-            phys_src += PAGE_SIZE;
-            virt_dest += PAGE_SIZE;
-        }
-
-        /* Copy what is remainig */
-        size = n % PAGE_SIZE;
-        if (size) {
-            frame_mount((uintptr_t) phys_src);
-            memcpy(virt_dest, p, size);
-        }
-
-        frame_mount(prev_mount);
     }
 
-    return ret;
+    return _virt_dest;
 }
 
 static void *copy_virtual_to_physical(void *_phys_dest, void *_virt_src, size_t n)
 {
-    char *phys_dest = (char *) _phys_dest;
-    char *virt_src  = (char *) _virt_src;
-    void *ret = phys_dest;
+    uintptr_t phys_dest = (uintptr_t) _phys_dest;
+    char *virt_src = (char *) _virt_src;
 
-    size_t s = n / PAGE_SIZE;
-    
-    uintptr_t prev_mount = frame_mount(0);
-
-    while (s--) {
-        frame_mount((uintptr_t) phys_dest);
-        void *p = MOUNT_ADDR;
-        memcpy(p, virt_src, PAGE_SIZE);
-        phys_dest += PAGE_SIZE;
-        virt_src  += PAGE_SIZE;
+    if (IS_LOWMEM(phys_dest, n)) {
+        memcpy(PHYS_TO_VIRT(phys_dest), virt_src, n);
+        return _phys_dest;
     }
 
-    s = n % PAGE_SIZE;
+    while (n) {
+        size_t offset = phys_dest & PAGE_MASK;
+        size_t size = MIN(n, PAGE_SIZE - offset);
 
-    if (s) {
-        frame_mount((uintptr_t) phys_dest);
-        void *p = MOUNT_ADDR;
-        memcpy(p, virt_src, s);
+        char *p = kmap(phys_dest - offset);
+        memcpy(p + offset, virt_src, size);
+        kunmap(p);
+
+        phys_dest += size;
+        virt_src  += size;
+        n -= size;
     }
 
-    frame_mount((uintptr_t) prev_mount);
-    return ret;
+    return _phys_dest;
 }
 
 static int map_phys_to_virt(uintptr_t phys, uintptr_t virt, size_t size, int flags)
@@ -382,10 +823,19 @@ static int map_phys_to_virt(uintptr_t phys, uintptr_t virt, size_t size, int fla
 
     size_t nr = (endptr - ptr) / PAGE_SIZE;
 
-    while (nr--) {
+    while (nr) {
+        if (huge_page_fits(phys, ptr, nr, flags)) {
+            huge_page_map(phys, ptr/TABLE_SIZE, flags);
+            ptr  += TABLE_SIZE;
+            phys += TABLE_SIZE;
+            nr   -= TABLE_SIZE/PAGE_SIZE;
+            continue;
+        }
+
         page_map_phys_to_virt(phys, ptr, flags);
         ptr += PAGE_SIZE;
         phys += PAGE_SIZE;
+        --nr;
     }
 
     return 1;
@@ -401,13 +851,40 @@ static int map_to_physical(uintptr_t ptr, size_t size, int flags)
     size_t nr = (endptr - ptr) / PAGE_SIZE;
 
     while (nr--) {
-        page_map(ptr, flags);
+        page_map(ptr, flags, 0);
         ptr += PAGE_SIZE;
     }
 
     return 1;
 }
 
+static void protect_pages(uintptr_t ptr, size_t size, int flags)
+{
+    uintptr_t endptr = UPPER_PAGE_BOUNDARY(ptr + size);
+    ptr = LOWER_PAGE_BOUNDARY(ptr);
+
+    arch_tlb_batch_begin();
+
+    for (; ptr < endptr; ptr += PAGE_SIZE) {
+        __page_t *page = page_get_mapping(ptr);
+
+        if (!page)
+            continue;
+
+        if (IS_TABLE_SHARED(ptr/TABLE_SIZE))
+            table_unshare(ptr/TABLE_SIZE);
+
+        /* Keep copy-on-write pages read-only, the fault handler fixes them */
+        int cow = !page->structure.shared && pages[GET_PHYS_ADDR(page)/PAGE_SIZE].refs > 1;
+
+        page->structure.write = !!(flags & (KW | UW)) && !cow;
+        page->structure.user = !!(flags & URWX);
+        tlb_unmap_page(ptr);
+    }
+
+    arch_tlb_batch_end();
+}
+
 static void unmap_from_physical(uintptr_t ptr, size_t size)
 {
     //printk("unmap_from_physical(ptr=%p, size=0x%x)\n", ptr, size);
@@ -416,26 +893,31 @@ static void unmap_from_physical(uintptr_t ptr, size_t size)
     uintptr_t start = UPPER_PAGE_BOUNDARY(ptr);
     uintptr_t end   = LOWER_PAGE_BOUNDARY(ptr + size);
 
-    size_t nr = (end - start)/PAGE_SIZE;
+    arch_tlb_batch_begin();
+
+    /* One table at a time, missing tables are skipped as a whole */
+    while (start < end) {
+        size_t pdidx = start / TABLE_SIZE;
+        uintptr_t next = MIN(end - 1, LOWER_TABLE_BOUNDARY(start) + TABLE_MASK) + 1;
+        int whole = !(start & TABLE_MASK) && next - start == TABLE_SIZE;
+
+        if (!PAGE_DIR[pdidx].structure.present) {
+            /* Nothing mapped */
+        } else if (whole && !IS_KERNEL_PDE(pdidx)) {
+            /* Drop the table with its pages at once, no need to unshare it */
+            table_dealloc(pdidx);
+        } else {
+            for (uintptr_t page = start; page < next; page += PAGE_SIZE)
+                page_unmap(page);
+
+            if (whole)
+                table_dealloc(pdidx);
+        }
 
-    while (nr--) {
-        page_unmap(start);
-        start += PAGE_SIZE;
+        start = next;
     }
 
-    /* Dealloc Tables */
-    start = UPPER_TABLE_BOUNDARY(ptr);
-    end   = LOWER_TABLE_BOUNDARY(ptr + size);
-
-    if (end > start) {
-        nr = (end - start)/TABLE_SIZE;
-
-        start /= TABLE_SIZE;
-        while (nr--) {
-            table_dealloc(start);
-            start += 1;
-        }
-    }
+    arch_tlb_batch_end();
 }
 
 static void unmap_full_from_physical(uintptr_t ptr, size_t size)
@@ -448,6 +930,8 @@ static void unmap_full_from_physical(uintptr_t ptr, size_t size)
 
     size_t nr = (end - start)/PAGE_SIZE;
 
+    arch_tlb_batch_begin();
+
     while (nr--) {
         page_unmap(start);
         start += PAGE_SIZE;
@@ -464,107 +948,155 @@ static void unmap_full_from_physical(uintptr_t ptr, size_t size)
         table_dealloc(start);
         start += 1;
     }
+
+    arch_tlb_batch_end();
 }
 
-static uintptr_t cur_pd = 0;
 static void switch_directory(uintptr_t new_dir)
 {
     //printk("switch_directory(%p)\n", new_dir);
     if (cur_pd == new_dir) return;
 
-    if (cur_pd) { /* Store current directory mapping in old_dir */
-        //printk("Storing old directory in %p\n", cur_pd);
-        copy_virtual_to_physical((void *) cur_pd, (void *) bootstrap_processor_table, 768 * 4);
+    /* Kernel mappings are global and shared, only user ones are flushed */
+    write_cr3(new_dir);
+    cur_pd = new_dir;
+}
+
+/* Lazy fork, user page tables are shared until either side changes them */
+static void copy_fork_mapping(uintptr_t base, uintptr_t fork)
+{
+    //printk("copy_fork_mapping(%p, %p)\n", base, fork);
+
+    if (base != cur_pd)
+        panic("Forking a directory other than the current one");
+
+    __table_t *dir = kmap(fork);
+
+    for (int i = 0; i < 768; ++i) {
+        if (PAGE_DIR[i].structure.present) {
+            PAGE_DIR[i].structure.write = 0;
+            dir[i] = PAGE_DIR[i];
+            pages[GET_PHYS_ADDR(&PAGE_DIR[i])/PAGE_SIZE].refs++;
+        }
     }
 
-    copy_physical_to_virtual((void *) bootstrap_processor_table, (void *) new_dir, 768 * 4);
-    cur_pd = new_dir;
+    kunmap(dir);
+
+    /* Our own tables just became read-only */
     TLB_flush();
 }
 
-/* Lazy fork */
-static void copy_fork_mapping(uintptr_t base, uintptr_t fork)
+/*
+ *  A file page can come from the page cache if all of it is file data,
+ *  or if the area runs to the end of the file (the cached copy is zero
+ *  filled past EOF). Otherwise, like the page holding the start of BSS,
+ *  it needs a private copy.
+ */
+static inline int file_page_cacheable(struct vma *vma, uintptr_t page_addr)
 {
-   //printk("copy_fork_mapping(%p, %p)\n", base, fork);
-   switch_directory(fork);
+    size_t area_off = page_addr - vma->start;
 
-   uintptr_t old_mount = frame_mount(base);
-   __table_t *p = (__table_t *) MOUNT_ADDR;
+    if (vma->flags & VMA_SHARED)
+        return 0;
 
-   for (int i = 0; i < 768; ++i) {
-       if (p[i].structure.present) {
-           table_alloc(i, URWX);    // FIXME
-           uintptr_t _m = frame_mount(GET_PHYS_ADDR(&p[i]));
-           __page_t *_p = MOUNT_ADDR;
-           
-           for (int j = 0; j < 1024; ++j) {
-               if (_p[j].structure.present) {
-                   __page_t *page_table = (__page_t *) (0xFFC00000 + 0x1000 * i);
-                   page_table[j].raw = _p[j].raw;
+    return area_off + PAGE_SIZE <= vma->filesz
+        || vma->off + vma->filesz >= vma->node->size;
+}
+
+/* Read a private copy of a file page */
+static void file_page_fill(struct vma *vma, uintptr_t page_addr)
+{
+    /* Map writable to fill it, the caller drops it to the area protection */
+    page_map(page_addr, vma->prot | UW, 0);
 
-                   if (_p[j].structure.write) {
-                       _p[j].structure.write = 0;
-                       page_table[j].structure.write = 0;
-                   }
+    size_t area_off = page_addr - vma->start;
+    off_t off = vma->off + area_off;
+    size_t size = 0;
 
-                   pages[GET_PHYS_ADDR(&_p[j])/PAGE_SIZE].refs++;
-               }
-           }
+    /* Stop at the end of the file data, e.g. where BSS starts */
+    if (area_off < vma->filesz && off < (off_t) vma->node->size)
+        size = MIN(PAGE_SIZE, MIN(vma->filesz - area_off, vma->node->size - off));
 
-           frame_mount(_m);
-       }
-   }
+    ssize_t ret = size ? vfs.read(vma->node, off, size, (void *) page_addr) : 0;
 
-   TLB_flush();
+    if (ret < 0)
+        ret = 0;
 
-   frame_mount(old_mount);
-   switch_directory(base);
+    memset((void *) (page_addr + ret), 0, PAGE_SIZE - ret);
 }
 
-void handle_page_fault(uintptr_t addr)
+void handle_page_fault(uintptr_t addr, int err)
 {
-    //printk("handle_page_fault(%p)\n", addr);
+    //printk("handle_page_fault(%p, 0x%x)\n", addr, err);
 
     uintptr_t page_addr = addr & ~PAGE_MASK;
-    __page_t *page = page_get_mapping(page_addr);
+    struct vma *vma = vma_find(cur_proc->vmas, addr);
 
-    if (page) { /* Page is mapped */
-        uintptr_t phys = GET_PHYS_ADDR(page);
-        size_t page_idx = phys/PAGE_SIZE;
-
-        if ((addr >= USER_STACK_BASE && addr < USER_STACK_BASE + USER_STACK_SIZE)   /* Stack? */
-             || (addr < cur_proc->heap_start)   /* Data section? FIXME */
-             || (addr < cur_proc->heap)) {  /* Allocated Heap */
-            if (pages[page_idx].refs == 1) {
-                page->structure.write = 1;
-                tlb_invalidate_page(addr);
-            } else {
-                pages[page_idx].refs--;
-                page->structure.present = 0;
-                page_map(page_addr, URWX);   /* FIXME */ 
-                copy_physical_to_virtual((void *) page_addr, (void *) phys, PAGE_SIZE);
-            }
+    if (!vma || !(vma->prot & URWX) || ((err & PF_WRITE) && !(vma->prot & UW))) {
+        printk("[%d] %s: Segmentation fault at %p [err=0x%x]\n", cur_proc->pid, cur_proc->name, addr, err);
+        send_signal(cur_proc->pid, SIGSEGV);
+        return;
+    }
 
+    __page_t *page = page_get_mapping(page_addr);
+
+    if (!page) {    /* Demand paging */
+        if (vma->type == VMA_DEVICE) {
+            /* Device areas are mapped in full by the driver at mmap time */
+            printk("[%d] %s: Bus error at %p\n", cur_proc->pid, cur_proc->name, addr);
+            send_signal(cur_proc->pid, SIGBUS);
             return;
         }
-    } else {
-        if (addr < cur_proc->heap && addr >= cur_proc->heap_start) {
-            page_map(page_addr, URWX);  /* FIXME */
-            memset((void *) page_addr, 0, PAGE_SIZE);
-            return;
+
+        if (vma->type == VMA_FILE && file_page_cacheable(vma, page_addr)) {
+            /*
+             *  Map the cached copy read-only, it is shared with every other
+             *  mapping of the file and writes to private areas copy it
+             */
+            uintptr_t phys = page_cache_get(vma->node, vma->off + (page_addr - vma->start));
+
+            if (phys) {
+                page_map_phys_to_virt(phys, page_addr, vma->prot & ~UW);
+                pages[phys/PAGE_SIZE].refs++;
+                return;
+            }
         }
 
-        // Send signal
-        printk("proc = [%d] %s\n", cur_proc->pid, cur_proc->name);
-        printk("-- heap %p\n", cur_proc->heap);
-        x86_proc_t *arch = cur_proc->arch;
-        x86_dump_registers(arch->regs);
-        panic("Not implemented\n");
+        if (vma->type == VMA_FILE)
+            file_page_fill(vma, page_addr);
+        else
+            page_map(page_addr, vma->prot, 1);
+
+        page = page_get_mapping(page_addr);
+        page->structure.write = !!(vma->prot & UW);
+        page->structure.shared = !!(vma->flags & VMA_SHARED);
+        tlb_invalidate_page(page_addr);
+        return;
+    }
+
+    if (!(err & PF_WRITE))  /* Raced with another fault, nothing to do */
+        return;
+
+    /* Write through a shared table, get a private one and retry */
+    if (IS_TABLE_SHARED(page_addr/TABLE_SIZE)) {
+        table_unshare(page_addr/TABLE_SIZE);
+        return;
     }
 
-    x86_proc_t *arch = cur_proc->arch;
-    x86_dump_registers(arch->regs);
-    panic("This is fucked up :)\n");
+    /* Write to a copy-on-write page */
+    uintptr_t phys = GET_PHYS_ADDR(page);
+    size_t page_idx = phys/PAGE_SIZE;
+
+    if (page->structure.shared || pages[page_idx].refs == 1) {
+        page->structure.write = 1;
+        tlb_invalidate_page(page_addr);
+    } else {
+        pages[page_idx].refs--;
+        page->structure.present = 0;
+        tlb_unmap_page(page_addr);
+        page_map(page_addr, vma->prot, 0);
+        copy_physical_to_virtual((void *) page_addr, (void *) phys, PAGE_SIZE);
+    }
 }
 
 void setup_32_bit_paging()
@@ -585,14 +1117,114 @@ void setup_32_bit_paging()
     for (int i = 0; bootstrap_processor_table[i].raw; ++i)
         bootstrap_processor_table[i].raw = 0;
 
+    /* Make the kernel respect read-only user pages, needed for copy-on-write */
+    write_cr0(read_cr0() | CR0_WP);
+
+    /* Memory mapped during boot is the start of the direct map */
+    for (int i = 768; bootstrap_processor_table[i].structure.present; ++i)
+        lowmem_end += TABLE_SIZE;
+
     TLB_flush();
 }
 
+/*
+ *  Called once PAT is detected, must run before any MWC mapping is made
+ */
+
+void setup_32_bit_pat()
+{
+    printk("[0] Kernel: PMM -> Enabling write-combining through PAT\n");
+
+    msr_write(IA32_PAT, PAT_VALUE);
+    pat_enabled = 1;
+
+    TLB_flush();
+}
+
+/*
+ *  Extends the linear mapping of the kernel image to cover low physical
+ *  memory, called after huge pages are set up so that it can use them
+ */
+
+void setup_32_bit_direct_map()
+{
+    size_t total = (buddies[0].bitmap.max_idx + 1) * PAGE_SIZE;
+    size_t size  = MIN(total, DIRECT_MAP_SIZE) & ~PAGE_MASK;
+
+    if (size > lowmem_end) {
+        map_phys_to_virt(lowmem_end, DIRECT_MAP_BASE + lowmem_end, size - lowmem_end, KRW);
+        lowmem_end = size;
+    }
+
+    printk("[0] Kernel: PMM -> Direct mapped %d MiB\n", lowmem_end / (1024 * 1024));
+}
+
+/*
+ *  Called once PSE is enabled, replaces the page tables the kernel image
+ *  was mapped with during boot with 4 MiB pages. The old tables are not
+ *  given back, they live in scratch[] inside the kernel image, below the
+ *  buddy system's kernel bound.
+ */
+
+void setup_32_bit_huge_pages()
+{
+    printk("[0] Kernel: PMM -> Mapping kernel using 4 MiB pages\n");
+
+    extern char scratch[]; /* Boot page tables, see boot/init.c */
+    size_t pdidx = 768;
+
+    pse_enabled = 1;
+
+    while (pdidx < 1022 && bootstrap_processor_table[pdidx].structure.present) {
+        uintptr_t table = bootstrap_processor_table[pdidx].raw & ~PAGE_MASK;
+
+        if (table != LMA((uintptr_t) scratch) + (pdidx - 768) * PAGE_SIZE)
+            break;
+
+        huge_page_map((pdidx - 768) * TABLE_SIZE, pdidx, KRWX);
+        ++pdidx;
+    }
+
+    TLB_flush();
+}
+
+/*
+ *  Called once PGE is enabled, marks all kernel mappings made so far as
+ *  global, the mount window is left alone as it is always invalidated
+ */
+
+void setup_32_bit_global_pages()
+{
+    printk("[0] Kernel: PMM -> Marking kernel pages global\n");
+
+    pge_enabled = 1;
+
+    for (size_t pdidx = 768; pdidx < 1022; ++pdidx) {
+        if (!PAGE_DIR[pdidx].structure.present)
+            continue;
+
+        if (PAGE_DIR[pdidx].structure.page_size) {
+            PAGE_DIR[pdidx].structure.global = 1;
+            continue;
+        }
+
+        __page_t *page_table = PAGE_TBL(pdidx);
+
+        for (size_t ptidx = 0; ptidx < 1024; ++ptidx) {
+            if (page_table[ptidx].structure.present)
+                page_table[ptidx].structure.global = 1;
+        }
+    }
+
+    tlb_flush_global();
+}
+
 pmman_t pmman = (pmman_t) {
     .map = &map_to_physical,
     .map_to = &map_phys_to_virt,
     .unmap = &unmap_from_physical,
     .unmap_full = &unmap_full_from_physical,
+    .protect = &protect_pages,
     .memcpypv = &copy_physical_to_virtual,
     .memcpyvp = &copy_virtual_to_physical,
     .memcpypp = &copy_physical_to_physical,
@@ -619,3 +1251,124 @@ void arch_release_frame(uintptr_t p)
 {
     frame_release(p);
 }
+
+void arch_page_ref(uintptr_t p)
+{
+    pages[p/PAGE_SIZE].refs++;
+}
+
+/* Drop a reference, the frame is released with the last one */
+void arch_page_unref(uintptr_t p)
+{
+    if (pages[p/PAGE_SIZE].refs == 1)
+        frame_release(p);
+
+    pages[p/PAGE_SIZE].refs--;
+}
+
+void arch_tlb_batch_begin()
+{
+    ++tlb_batch_depth;
+}
+
+void arch_tlb_batch_end()
+{
+    if (--tlb_batch_depth || !tlb_batch_dirty)
+        return;
+
+    if (tlb_batch_full) {
+        tlb_flush_dirty(tlb_batch_dirty);
+    } else {
+        for (size_t i = 0; i < tlb_batch_nr; ++i)
+            tlb_invalidate_page(tlb_batch_pages[i]);
+
+        tlb_shootdown(tlb_batch_dirty, tlb_batch_pages, tlb_batch_nr);
+    }
+
+    tlb_batch_dirty = 0;
+    tlb_batch_full  = 0;
+    tlb_batch_nr    = 0;
+}
+
+void *arch_kmap(uintptr_t paddr)
+{
+    return kmap(paddr);
+}
+
+void arch_kunmap(void *addr)
+{
+    kunmap(addr);
+}
+
+uintptr_t arch_new_page_directory()
+{
+    return directory_new();
+}
+
+void arch_free_page_directory(uintptr_t pd)
+{
+    directory_free(pd);
+}
+
+int arch_prezero_frame()
+{
+    return zero_pool_fill();
+}
+
+void arch_meminfo(struct meminfo *info)
+{
+    info->zeroed = zero_pool_count;
+    info->page_tables = nr_page_tables;
+
+    size_t frames = MIN(info->total, sizeof(pages)/sizeof(pages[0]));
+
+    for (size_t i = 0; i < frames; ++i) {
+        if (pages[i].refs > 1)
+            ++info->cow_shared;
+    }
+}
+
+static size_t table_rss(__page_t *table)
+{
+    size_t rss = 0;
+
+    for (int i = 0; i < 1024; ++i) {
+        if (table[i].structure.present)
+            ++rss;
+    }
+
+    return rss;
+}
+
+/* Resident user pages of a process, in pages */
+size_t arch_proc_rss(proc_t *proc)
+{
+    x86_proc_t *arch = proc->arch;
+    size_t rss = 0;
+
+    if (!arch || !arch->pd)
+        return 0;
+
+    if (arch->pd == cur_pd) {   /* Reachable through the recursive mapping */
+        for (int i = 0; i < 768; ++i) {
+            if (PAGE_DIR[i].structure.present)
+                rss += table_rss(PAGE_TBL(i));
+        }
+
+        return rss;
+    }
+
+    __table_t *dir = kmap(arch->pd);
+
+    for (int i = 0; i < 768; ++i) {
+        if (dir[i].structure.present) {
+            __page_t *table = kmap(GET_PHYS_ADDR(&dir[i]));
+            rss += table_rss(table);
+            kunmap(table);
+        }
+    }
+
+    kunmap(dir);
+
+    return rss;
+}
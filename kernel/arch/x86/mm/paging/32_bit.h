@@ -36,7 +36,8 @@ typedef union __table {
         size_t accessed : 1;
         size_t __ignored_0: 1;
         size_t page_size : 1;
-        size_t __ignored_1 : 4;
+        size_t global : 1;  /* 4 MiB pages only */
+        size_t __ignored_1 : 3;
         uintptr_t phys_addr : 20;
     } __packed structure;
     uint32_t raw;
@@ -60,7 +61,9 @@ typedef union __page {
         size_t dirty : 1;
         size_t memory_type: 1;
         size_t global : 1;
-        size_t __ignored : 3;
+        size_t shared : 1;  /* Software: MAP_SHARED page, never copy-on-write */
+        size_t io : 1;      /* Software: I/O memory, no page frame behind it */
+        size_t __ignored : 1;
         uintptr_t phys_addr : 20;
     } __packed structure;
     uint32_t raw;
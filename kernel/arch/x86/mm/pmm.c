@@ -371,10 +371,32 @@ void arch_pmm_setup()
 #if !defined(X86_PAE) || !X86_PAE
     extern void setup_32_bit_paging();
     setup_32_bit_paging();
-    //if (features.pse) {
-    //    //write_cr4(read_cr4() | CR4_PSE);
-    //    printk("[0] Kernel: PMM -> Found PSE support\n");
-    //}
+
+    if (features.pse) {
+        printk("[0] Kernel: PMM -> Found PSE support\n");
+        write_cr4(read_cr4() | CR4_PSE);
+
+        extern void setup_32_bit_huge_pages();
+        setup_32_bit_huge_pages();
+    }
+
+    extern void setup_32_bit_direct_map();
+    setup_32_bit_direct_map();
+
+    if (features.pat) {
+        printk("[0] Kernel: PMM -> Found PAT support\n");
+
+        extern void setup_32_bit_pat();
+        setup_32_bit_pat();
+    }
+
+    if (features.pge) {
+        printk("[0] Kernel: PMM -> Found PGE support\n");
+        write_cr4(read_cr4() | CR4_PGE);
+
+        extern void setup_32_bit_global_pages();
+        setup_32_bit_global_pages();
+    }
 #else   /* PAE */
     panic("PAE Not supported");
     if (features.pae) {
@@ -12,12 +12,15 @@
 #include <core/string.h>
 #include <core/panic.h>
 #include <mm/mm.h>
+#include <mm/slab.h>
+#include <mm/vmalloc.h>
 
 typedef struct {
     uint32_t addr : 28; /* Offseting (1GiB), 4-bytes aligned objects */
     uint32_t free : 1;  /* Free or not flag */
     uint32_t size : 26; /* Size of one object can be up to 256MiB */
-    uint32_t next : 25; /* Index of the next node */
+    uint32_t next : 24; /* Index of the next node */
+    uint32_t mapped : 1;/* Might still have pages mapped */
 } __packed vmm_node_t;
 
 
@@ -29,6 +32,17 @@ typedef struct {
 #define LAST_NODE_INDEX (100000)
 #define MAX_NODE_SIZE   ((1UL << 26) - 1)
 
+/*
+ *  Pages backing free nodes are not unmapped right away, they are released
+ *  in batches once enough memory is pending, or immediately if the freed
+ *  range alone is large enough, or when running out of frames
+ */
+#define VMM_RELEASE_RANGE   (256 * 1024UL)  /* Per-range watermark */
+#define VMM_RELEASE_HIGH    (1024 * 1024UL) /* Pending bytes watermark */
+
+static size_t vmm_pending = 0;  /* Bytes freed but still mapped */
+static uintptr_t vmm_top = VMM_BASE;    /* End of highest mapped node */
+
 vmm_node_t *nodes = (vmm_node_t *) VMM_NODES;
 void vmm_setup()
 {
@@ -39,7 +53,10 @@ void vmm_setup()
     memset((void *) VMM_NODES, 0, VMM_NODES_SIZE);
 
     /* Setting up initial node */
-    nodes[0] = (vmm_node_t){0, 1, -1, LAST_NODE_INDEX};
+    nodes[0] = (vmm_node_t){0, 1, -1, LAST_NODE_INDEX, 0};
+
+    /* Small objects are served by the slab allocator */
+    slab_setup();
 }
 
 uint32_t first_free_node = 0;
@@ -89,9 +106,9 @@ void print_node(unsigned i)
     printk("   |_ Next   : %d\n", nodes[i].next );
 }
 
-void *kmalloc(size_t size)
+static void *node_alloc(size_t size)
 {
-    //printk("kmalloc(%d)\n", size);
+    //printk("node_alloc(%d)\n", size);
     size = (size + 3)/4;    /* size in 4-bytes units */
 
     /* Look for a first fit free node */
@@ -107,20 +124,64 @@ void *kmalloc(size_t size)
             .addr = nodes[i].addr + size,
             .free = 1,
             .size = nodes[i].size - size,
-            .next = nodes[i].next
+            .next = nodes[i].next,
+            .mapped = nodes[i].mapped,
         };
 
         nodes[i].next = n;
         nodes[i].size = size;
     }
 
+    /* Reusing a range that was still pending release */
+    if (nodes[i].mapped)
+        vmm_pending -= MIN(vmm_pending, NODE_SIZE(nodes[i]));
+
     pmman.map(NODE_ADDR(nodes[i]), NODE_SIZE(nodes[i]), KRW);
+    nodes[i].mapped = 1;
+    vmm_top = MAX(vmm_top, NODE_ADDR(nodes[i]) + NODE_SIZE(nodes[i]));
+
     return (void *) NODE_ADDR(nodes[i]);
 }
 
-void kfree(void *_ptr)
+/* Unmap pages backing all free nodes, invalidated as a single batch */
+static void vmm_release()
+{
+    arch_tlb_batch_begin();
+
+    for (unsigned i = 0; i < LAST_NODE_INDEX; i = nodes[i].next) {
+        if (nodes[i].free && nodes[i].mapped) {
+            uintptr_t addr = NODE_ADDR(nodes[i]);
+            uintptr_t end  = MIN(addr + NODE_SIZE(nodes[i]), vmm_top);
+
+            if (end > addr)
+                pmman.unmap(addr, end - addr);
+
+            nodes[i].mapped = 0;
+        }
+
+        if (nodes[i].next == LAST_NODE_INDEX)
+            break;
+    }
+
+    arch_tlb_batch_end();
+    vmm_pending = 0;
+}
+
+void vmm_reclaim()
+{
+    static int reclaiming = 0;
+
+    if (reclaiming)
+        return;
+
+    reclaiming = 1;
+    vmm_release();
+    reclaiming = 0;
+}
+
+static void node_free(void *_ptr)
 {
-    //printk("kfree(%p)\n", _ptr);
+    //printk("node_free(%p)\n", _ptr);
     uintptr_t ptr = (uintptr_t) _ptr;
 
     if (ptr < VMM_BASE)  /* That's not even allocatable */
@@ -136,6 +197,7 @@ void kfree(void *_ptr)
             if ((uintptr_t) (nodes[cur_node].size + nodes[prev_node].size) <= MAX_NODE_SIZE) {
                 nodes[prev_node].size += nodes[cur_node].size;
                 nodes[prev_node].next  = nodes[cur_node].next;
+                nodes[prev_node].mapped |= nodes[cur_node].mapped;
                 release_node(cur_node);
                 cur_node = nodes[prev_node].next;
                 continue;
@@ -153,6 +215,18 @@ void kfree(void *_ptr)
     /* First we mark our node as free */
     nodes[cur_node].free = 1;
 
+    uintptr_t freed_addr = NODE_ADDR(nodes[cur_node]);
+    size_t    freed_size = NODE_SIZE(nodes[cur_node]);
+
+    /* Release large ranges right away, batch the rest -- done before
+     * merging so the merged node only inherits its neighbours' state */
+    if (freed_size >= VMM_RELEASE_RANGE) {
+        pmman.unmap(freed_addr, freed_size);
+        nodes[cur_node].mapped = 0;
+    } else {
+        vmm_pending += freed_size;
+    }
+
     /* Now we merge all free nodes ahead -- except the last node */
     while (nodes[cur_node].next < LAST_NODE_INDEX && nodes[cur_node].free) {
         /* check if current and previous node are free */
@@ -161,6 +235,7 @@ void kfree(void *_ptr)
             if ((uintptr_t) (nodes[cur_node].size + nodes[prev_node].size) <= MAX_NODE_SIZE) {
                 nodes[prev_node].size += nodes[cur_node].size;
                 nodes[prev_node].next  = nodes[cur_node].next;
+                nodes[prev_node].mapped |= nodes[cur_node].mapped;
                 release_node(cur_node);
                 cur_node = nodes[prev_node].next;
                 continue;
@@ -171,13 +246,29 @@ void kfree(void *_ptr)
         cur_node = nodes[cur_node].next;
     }
 
-    cur_node = 0;
-    while (nodes[cur_node].next < LAST_NODE_INDEX) {
-        if (nodes[cur_node].free) {
-            pmman.unmap(NODE_ADDR(nodes[cur_node]), NODE_SIZE(nodes[cur_node]));
-        }
-        cur_node = nodes[cur_node].next;
-    }
+    if (vmm_pending >= VMM_RELEASE_HIGH)
+        vmm_release();
+}
+
+void *kmalloc(size_t size)
+{
+    if (size <= KMALLOC_MAX_SIZE)
+        return kmem_alloc(size);
+
+    if (size >= PAGE_SIZE)
+        return vmalloc(size, 0);
+
+    return node_alloc(size);
+}
+
+void kfree(void *ptr)
+{
+    if (IS_SLAB_ADDR(ptr))
+        kmem_free(ptr);
+    else if (IS_VMALLOC_ADDR(ptr))
+        vfree(ptr);
+    else
+        node_free(ptr);
 }
 
 void dump_nodes()
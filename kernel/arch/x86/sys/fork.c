@@ -4,25 +4,55 @@
 
 #include <sys/proc.h>
 #include <sys/sched.h>
+#include <mm/slab.h>
+#include <mm/vmalloc.h>
 
 #include <bits/errno.h>
 
 #include "sys.h"
 
+/* The child resumes from a copy of the parent's kernel stack */
+static int fork_kstack(x86_proc_t *orig_arch, x86_proc_t *fork_arch)
+{
+    /* Setup kstack */
+    uintptr_t fork_kstack_base = (uintptr_t) vmalloc(KERN_STACK_SIZE, VM_STACK);
+
+    if (!fork_kstack_base)
+        return -ENOMEM;
+
+    fork_arch->kstack = fork_kstack_base + KERN_STACK_SIZE;
+
+    /* Copy registers */
+    size_t kstack_used = orig_arch->kstack - (uintptr_t) orig_arch->regs;
+    regs_t *fork_regs = (void *) (fork_arch->kstack - kstack_used);
+    fork_arch->regs = fork_regs;
+
+    /* Copy the used part of kstack, the child resumes from the saved registers */
+    memcpy((void *) fork_regs, (void *) orig_arch->regs, kstack_used);
+
+    /* The first switch to the child returns to x86_fork_return right below them */
+    extern void x86_fork_return();
+    fork_arch->kesp = x86_switch_frame_init((uintptr_t) fork_regs, x86_fork_return);
+
+    return 0;
+}
+
 int arch_sys_fork(proc_t *proc)
 {
     x86_proc_t *orig_arch = cur_proc->arch;
-    x86_proc_t *fork_arch = kmalloc(sizeof(x86_proc_t));
+    x86_proc_t *fork_arch = kmem_cache_alloc(&x86_proc_cache);
 
     if (!fork_arch) {   /* Failed to allocate fork arch structure */
         return -ENOMEM;
     }
 
+    memset(fork_arch, 0, sizeof(x86_proc_t));
+
     uintptr_t cur_proc_pd = orig_arch->pd;
     uintptr_t new_proc_pd = get_new_page_directory();
     
     if (!new_proc_pd) { /* Failed to allocate page directory */
-        kfree(fork_arch);
+        kmem_cache_free(&x86_proc_cache, fork_arch);
         return -ENOMEM;
     }
 
@@ -91,25 +121,58 @@ int arch_sys_fork(proc_t *proc)
     kfree(stack_buf);
 #endif
 
-    /* Setup kstack */
-    uintptr_t fork_kstack_base = (uintptr_t) kmalloc(KERN_STACK_SIZE);
-    fork_arch->kstack = fork_kstack_base + KERN_STACK_SIZE;
+    if (fork_kstack(orig_arch, fork_arch)) {
+        free_page_directory(new_proc_pd);
+        kmem_cache_free(&x86_proc_cache, fork_arch);
+        return -ENOMEM;
+    }
 
-    /* Copy registers */
-    regs_t *fork_regs = (void *) (fork_arch->kstack - (orig_arch->kstack - (uintptr_t) orig_arch->regs));  //(fork_arch->kstack - sizeof(regs_t));
-    fork_arch->regs = fork_regs;
+    fork_arch->pd = new_proc_pd;
+    proc->arch = fork_arch;
 
-    /* Copy kstack */
-    memcpy((void *) fork_kstack_base, (void *) (orig_arch->kstack - KERN_STACK_SIZE), KERN_STACK_SIZE);
+    return 0;
+}
 
-    extern void x86_fork_return();
-    fork_arch->eip = (uintptr_t) x86_fork_return;
-    fork_arch->esp = (uintptr_t) fork_regs;
-    //fork_arch->ebp = orig_arch->regs->ebp;
-    //fork_arch->eflags = orig_arch->regs->eflags;
+int arch_sys_vfork(proc_t *proc)
+{
+    x86_proc_t *orig_arch = cur_proc->arch;
+    x86_proc_t *fork_arch = kmem_cache_alloc(&x86_proc_cache);
 
-    fork_arch->pd = new_proc_pd;
+    if (!fork_arch) {   /* Failed to allocate fork arch structure */
+        return -ENOMEM;
+    }
+
+    memset(fork_arch, 0, sizeof(x86_proc_t));
+
+    if (fork_kstack(orig_arch, fork_arch)) {
+        kmem_cache_free(&x86_proc_cache, fork_arch);
+        return -ENOMEM;
+    }
+
+    /* Run in the parent's address space */
+    fork_arch->pd = orig_arch->pd;
     proc->arch = fork_arch;
 
     return 0;
 }
+
+int arch_vfork_release(proc_t *proc, int exec)
+{
+    x86_proc_t *arch = proc->arch;
+
+    if (!exec) {
+        /* The page directory belongs to the parent, do not free it on reap */
+        arch->pd = 0;
+        return 0;
+    }
+
+    uintptr_t new_proc_pd = get_new_page_directory();
+
+    if (!new_proc_pd)
+        return -ENOMEM;
+
+    arch->pd = new_proc_pd;
+    switch_page_directory(new_proc_pd);
+
+    return 0;
+}
@@ -5,9 +5,13 @@
 #include <sys/sched.h>
 #include <sys/signal.h>
 #include <ds/queue.h>
+#include <mm/slab.h>
+#include <mm/vmalloc.h>
 
 #include "sys.h"
 
+struct kmem_cache x86_proc_cache = KMEM_CACHE_INIT("x86_proc_t", sizeof(x86_proc_t), SLAB_CACHE_LINE, NULL);
+
 void arch_spawn_proc(proc_t *proc)
 {
     x86_proc_t *arch = proc->arch;
@@ -23,12 +27,12 @@ void arch_spawn_proc(proc_t *proc)
 
 void arch_init_proc(void *d, proc_t *p)
 {
-    x86_proc_t *arch = memset(kmalloc(sizeof(x86_proc_t)), 0, sizeof(x86_proc_t));
+    x86_proc_t *arch = memset(kmem_cache_alloc(&x86_proc_cache), 0, sizeof(x86_proc_t));
     struct arch_load_elf *s = d;
 
     arch->pd = s->new;
 
-    uintptr_t kstack_base = (uintptr_t) kmalloc(KERN_STACK_SIZE);
+    uintptr_t kstack_base = (uintptr_t) vmalloc(KERN_STACK_SIZE, VM_STACK);
     arch->kstack = kstack_base + KERN_STACK_SIZE;   /* Kernel stack */
     arch->eip = p->entry;
     arch->esp = USER_STACK;
@@ -37,53 +41,95 @@ void arch_init_proc(void *d, proc_t *p)
     p->arch = arch;
 }
 
-void arch_switch_proc(proc_t *proc)
+/* Build a frame at the top of `stack' that the first switch to it returns to `entry' from */
+uintptr_t x86_switch_frame_init(uintptr_t stack, void (*entry)())
 {
-    x86_proc_t *arch = proc->arch;
-    //printk("[%d] %s: Switching [KSTACK: %p, EIP: %p, ESP: %p]\n", proc->pid, proc->name, arch->kstack, arch->eip, arch->esp);
+    struct x86_switch_frame *frame = (struct x86_switch_frame *) stack - 1;
 
-    switch_page_directory(arch->pd);
-    set_kernel_stack(arch->kstack);
-    disable_fpu();
+    memset(frame, 0, sizeof(*frame));
+    frame->eip = (uintptr_t) entry;
 
-    if (proc->signals_queue->count) {
-        //printk("There are %d pending signals\n", proc->signals_queue->count);
-        int sig = (int) dequeue(proc->signals_queue);
+    return (uintptr_t) frame;
+}
+
+/* Called in the context of the process we switched to, about to resume */
+void x86_switch_done()
+{
+    /* Signals wait until a vfork child gives the address space back */
+    if (cur_proc->signals_queue->count && !cur_proc->vfork_lent) {
+        //printk("There are %d pending signals\n", cur_proc->signals_queue->count);
+        int sig = (int) dequeue(cur_proc->signals_queue);
         arch_handle_signal(sig);
-        for (;;);
     }
+}
 
-    extern void x86_goto(uintptr_t eip, uintptr_t ebp, uintptr_t esp) __attribute__((noreturn));
-    x86_goto(arch->eip, arch->ebp, arch->esp);
+/* First switch to a process that was never spawned */
+static void spawn_entry()
+{
+    spawn_proc(cur_proc);
 }
 
-void arch_kill_proc(proc_t *proc)
+/*
+ *  Switch from `prev' to `next', NULL is the idle context for either.
+ *  Returns in the context of `prev' once it is switched to again.
+ */
+void arch_switch_proc(proc_t *prev, proc_t *next)
 {
+    uintptr_t *prev_esp = prev ? &((x86_proc_t *) prev->arch)->kesp : &x86_idle_esp;
+    uintptr_t next_esp = x86_idle_esp;
+
+    if (next) {
+        x86_proc_t *arch = next->arch;
+        //printk("[%d] %s: Switching [KSTACK: %p, KESP: %p]\n", next->pid, next->name, arch->kstack, arch->kesp);
+
+        /* Idle keeps the last address space, a vfork child shares its parent's,
+         * switching back to the same one keeps the TLB */
+        if (arch->pd != get_current_page_directory())
+            switch_page_directory(arch->pd);
+
+        set_kernel_stack(arch->kstack);
+        switch_fpu(next);
+
+        if (!next->spawned)
+            arch->kesp = x86_switch_frame_init(arch->kstack, spawn_entry);
+
+        next_esp = arch->kesp;
+    }
 
+    x86_switch_to(prev_esp, next_esp);
+
+    if (prev)
+        x86_switch_done();
 }
 
-void arch_sleep()
+void arch_kill_proc(proc_t *proc)
 {
-    extern void x86_sleep();
-    x86_sleep();
+
 }
 
-void internal_arch_sleep()
+void arch_reap_proc(proc_t *proc)
 {
-    x86_proc_t *arch = cur_proc->arch;
-    extern uintptr_t x86_read_eip();
+    x86_proc_t *arch = proc->arch;
 
-    uintptr_t eip = 0, esp = 0, ebp = 0;    
-    asm("mov %%esp, %0":"=r"(esp)); /* read esp */
-    asm("mov %%ebp, %0":"=r"(ebp)); /* read ebp */
-    eip = x86_read_eip();
+    /* kstack might have been moved down by a signal frame */
+    vfree((void *) (arch->kstack - KERN_STACK_SIZE));
 
-    if (eip == (uintptr_t) -1) {  /* Done switching */
-        return;
-    }
+    if (arch->pd)   /* A vfork child that exited has none */
+        free_page_directory(arch->pd);
+
+    if (arch->fpu_context)
+        kfree(arch->fpu_context);
+
+    kmem_cache_free(&x86_proc_cache, arch);
+}
+
+void arch_switch_mm(proc_t *proc)
+{
+    x86_proc_t *arch = proc->arch;
+    switch_page_directory(arch->pd);
+}
 
-    arch->eip = eip;
-    arch->esp = esp;
-    arch->ebp = ebp;
-    kernel_idle();
+void arch_sleep()
+{
+    schedule();
 }
@@ -2,61 +2,130 @@
 #include <core/arch.h>
 #include <sys/proc.h>
 #include <sys/sched.h>
+#include <sys/timer.h>
+#include <sys/clock.h>
 #include <mm/mm.h>
 
 #include "sys.h"
 
-static void x86_sched_handler(regs_t *r __unused) 
+/*
+ *  The tick is stopped while idle, the clock event is armed once for the
+ *  next timer and whatever interrupt comes first ends the idle period.
+ *  The ticks missed meanwhile are accounted for from the TSC, counting from
+ *  the last tick accounted so that partial ticks carry over to the next
+ *  idle period. The first tick after is armed for what is left of the
+ *  current one, the periodic tick restarts from there.
+ */
+
+static int tick_stopped = 0;
+static int tick_resync = 0;     /* One-shot to the next tick boundary armed */
+static uint64_t tick_last = 0;  /* TSC at the last tick accounted */
+
+static inline uint32_t tsc_per_tick()
 {
-    //extern queue_t *procs;
-    //printk("----- procs dump -----\n");
-    //forlinked (node, procs->head, node->next) {
-    //    proc_t *proc = node->value;
-    //    printk("(%d, %s)\n", proc->pid, proc->name);
-    //}
-    //printk("----------------------\n");
+    return div_u64_u32((uint64_t) tsc_khz * 1000, HZ);
+}
 
-    if (!kidle) {
-        x86_proc_t *arch = (x86_proc_t *) cur_proc->arch;
-        extern uintptr_t x86_read_eip();
+/* Microseconds left until the TSC reaches `tsc', at least one */
+static uint32_t tsc_usec_until(uint64_t tsc)
+{
+    uint64_t now = read_tsc();
 
-        volatile uintptr_t eip = 0, esp = 0, ebp = 0;    
-        asm volatile("mov %%esp, %0":"=r"(esp)); /* read esp */
-        asm volatile("mov %%ebp, %0":"=r"(ebp)); /* read ebp */
-        eip = x86_read_eip();
+    if (tsc <= now)
+        return 1;
 
-        if (eip == (uintptr_t) -1) {    /* Done switching */
-            return;
-        }
+    return MAX(div_u64_u32((tsc - now) * 1000, tsc_khz), 1);
+}
 
-        arch->eip = eip;
-        arch->esp = esp;
-        arch->ebp = ebp;
-    }
+static void tick_stop()
+{
+    if (!tsc_khz)   /* No way to tell how long we slept */
+        return;
+
+    uint64_t next = timer_next();
+    uint32_t ticks = next > jiffies ? MIN(next - jiffies, HZ) : 0;
+
+    tick_stopped = 1;
+    tick_resync = 0;
+    clock_event_oneshot(tsc_usec_until(tick_last + (uint64_t) ticks * tsc_per_tick()));
+}
+
+static void tick_restart()
+{
+    uint32_t cycles_per_tick = tsc_per_tick();
+    uint32_t ticks = div_u64_u32(read_tsc() - tick_last, cycles_per_tick);
+
+    tick_stopped = 0;
+    jiffies += ticks;
+    tick_last += (uint64_t) ticks * cycles_per_tick;
+
+    /* Periodic again from the next tick boundary, see x86_sched_handler */
+    tick_resync = 1;
+    clock_event_oneshot(tsc_usec_until(tick_last + cycles_per_tick));
+
+    clock_update();
+    timer_run();
+}
+
+/*
+ *  The idle context has a stack of its own and is switched to like any
+ *  process when nothing is ready to run. Interrupts taken while idle run
+ *  on that stack and switch away from it from there.
+ */
+static char idle_stack[KERN_STACK_SIZE] __aligned(16);
+uintptr_t x86_idle_esp;
+
+/* Switch to the next process, we return here once it is our turn again */
+void arch_sched()
+{
+    if (tick_stopped)
+        tick_restart();
 
     schedule();
 }
 
-void arch_sched_init()
+static void x86_sched_handler(regs_t *r)
 {
-    pit_setup(1);
-    irq_install_handler(PIT_IRQ, x86_sched_handler);
+    if (!tick_stopped) {
+        if (tick_resync) {  /* On the tick boundary, periodic from here on */
+            tick_resync = 0;
+            tick_last += tsc_per_tick();
+            clock_event_periodic(HZ);
+        } else if (tsc_khz) {
+            tick_last = read_tsc();
+        }
+
+        sched_tick(r->cs & 3);  /* Interrupted user mode */
+    }
+
+    arch_sched();
 }
 
-void __arch_idle()
+static void arch_idle()
 {
-    //printk("__arch_idle()\n");
     for (;;) {
-        asm volatile("sti; hlt; cli;");
+        /* First time here, or back after a process went to sleep or the
+         * clock event ended the idle period without a switch */
+        if (!tick_stopped)
+            tick_stop();
+
+        /* Use idle time to clear free frames, a page at a time so that
+         * pending interrupts are not held off for long */
+        if (arch_prezero_frame())
+            asm volatile("sti; nop; cli;");
+        else
+            asm volatile("sti; hlt; cli;");
     }
 }
 
-void arch_idle()
+void arch_sched_init()
 {
-    //printk("Kernel Idle\n");
-    cur_proc = NULL;
-    uintptr_t esp = VMA(0x100000);
-    set_kernel_stack(esp);
-    asm volatile("mov %0, %%esp; mov %0, %%ebp; jmp __arch_idle;"::"g"(esp), "g"(__arch_idle));
-    //__arch_idle();
+    x86_idle_esp = x86_switch_frame_init((uintptr_t) idle_stack + KERN_STACK_SIZE, arch_idle);
+
+    clock_event_setup(x86_sched_handler);
+    clock_event_periodic(HZ);
+
+    if (tsc_khz)
+        tick_last = read_tsc();
+    clock_init(tsc_khz ? &tsc_clock_source : NULL, rtc_time());
 }
@@ -14,7 +14,7 @@ void arch_handle_signal(int sig)
         case SIGACT_ABORT:
         case SIGACT_TERMINATE:
             kill_proc(cur_proc);
-            kernel_idle();
+            schedule();
             break;  /* We should never reach this anyway */
     }
 
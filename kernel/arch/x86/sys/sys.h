@@ -18,8 +18,13 @@ static inline uintptr_t get_current_page_directory()
 
 static inline uintptr_t get_new_page_directory()
 {
-	/* Get a free page frame for storing Page Directory */
-	return arch_get_frame();
+	/* Get a page directory sharing the kernel mappings */
+	return arch_new_page_directory();
+}
+
+static inline void free_page_directory(uintptr_t pd)
+{
+	arch_free_page_directory(pd);
 }
 
 static inline void switch_page_directory(uintptr_t pd)
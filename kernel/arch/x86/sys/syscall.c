@@ -9,6 +9,10 @@ void arch_syscall(regs_t *r)
 	/* FIXME: Add some out-of-bounds checking code here */
 	void (*syscall)() = syscall_table[r->eax];
 	syscall(r->ebx, r->ecx, r->edx);
+
+	/* The syscall woke up a process that outranks us */
+	if (need_resched)
+		arch_sched();
 }
 
 void arch_syscall_return(proc_t *proc, uintptr_t val)
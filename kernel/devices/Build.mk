@@ -2,6 +2,7 @@ obj-y += ramdev.o
 obj-y += i8042.o
 obj-y += ps2kbd.o
 obj-y += console.o
+obj-y += meminfo.o
 obj-y += devman.o
 dirs-y += bus/
 dirs-y += video/
@@ -9,6 +9,7 @@ dev_t *devices[] =
     &pcidev,
     &atadev,
     &fbdev,
+    &meminfodev,
 	NULL
 };
 
@@ -0,0 +1,124 @@
+/**********************************************************************
+ *                  Memory Information Device
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/string.h>
+#include <core/arch.h>
+
+#include <mm/mm.h>
+#include <mm/meminfo.h>
+#include <mm/slab.h>
+
+#include <dev/dev.h>
+#include <fs/devfs.h>
+
+#include <ds/queue.h>
+#include <bits/errno.h>
+
+#define MEMINFO_BUF_SIZE    (8 * 1024)
+#define KB(frames)          ((frames) * (PAGE_SIZE / 1024))
+
+/*
+ *  Text is generated on every read, so a reader should consume it with as
+ *  few reads as possible to get a consistent snapshot.
+ */
+
+static size_t meminfo_format(char *buf, size_t size)
+{
+    struct meminfo info;
+    meminfo_get(&info);
+
+    size_t len = 0;
+
+    len += snprintf(buf + len, size - len, "MemTotal: %d kB\n", KB(info.total));
+    len += snprintf(buf + len, size - len, "MemFree: %d kB\n", KB(info.free + info.cached + info.zeroed));
+    len += snprintf(buf + len, size - len, "MemUsed: %d kB\n", KB(info.used));
+    len += snprintf(buf + len, size - len, "FrameCache: %d kB\n", KB(info.cached));
+    len += snprintf(buf + len, size - len, "ZeroPool: %d kB\n", KB(info.zeroed));
+    len += snprintf(buf + len, size - len, "PageTables: %d kB\n", KB(info.page_tables));
+    len += snprintf(buf + len, size - len, "CowShared: %d kB\n", KB(info.cow_shared));
+    len += snprintf(buf + len, size - len, "PageCache: %d kB\n", KB(info.page_cache));
+    len += snprintf(buf + len, size - len, "Slab: %d kB\n", info.slab / 1024);
+    len += snprintf(buf + len, size - len, "Vmalloc: %d kB\n", info.vmalloc / 1024);
+
+    len += snprintf(buf + len, size - len, "\nBuddy:");
+    for (size_t i = 0; i <= BUDDY_MAX_ORDER; ++i)
+        len += snprintf(buf + len, size - len, " %d", info.free_blocks[i]);
+    len += snprintf(buf + len, size - len, "\n");
+
+    len += snprintf(buf + len, size - len, "\nSlab caches:\n");
+    for (struct kmem_cache *cache = kmem_caches; cache; cache = cache->next) {
+        len += snprintf(buf + len, size - len, "%s: %d B [%d/%d objects]\n",
+                (char *) cache->name, KMEM_CACHE_BYTES(cache),
+                cache->active, cache->nr_slabs * cache->objs);
+    }
+
+    extern queue_t *procs;
+
+    len += snprintf(buf + len, size - len, "\nProcesses:\n");
+    forlinked (node, procs->head, node->next) {
+        proc_t *proc = node->value;
+        len += snprintf(buf + len, size - len, "[%d] %s: %d kB\n",
+                proc->pid, proc->name, KB(arch_proc_rss(proc)));
+    }
+
+    return len;
+}
+
+static ssize_t meminfo_read(struct fs_node *dev __unused, off_t offset, size_t size, void *buf)
+{
+    char *text = kmalloc(MEMINFO_BUF_SIZE);
+
+    if (!text)
+        return -ENOMEM;
+
+    size_t len = meminfo_format(text, MEMINFO_BUF_SIZE);
+
+    if ((size_t) offset >= len) {
+        kfree(text);
+        return 0;
+    }
+
+    size = MIN(size, len - offset);
+    memcpy(buf, text + offset, size);
+    kfree(text);
+
+    return size;
+}
+
+static int meminfo_probe()
+{
+    vfs.create(dev_root, "meminfo");
+
+    struct vfs_path path = (struct vfs_path) {
+        .mountpoint = dev_root,
+        .tokens = (char *[]) {"meminfo", NULL}
+    };
+
+    struct fs_node *meminfo = vfs.traverse(&path);
+    meminfo->dev = &meminfodev;
+
+    return 0;
+}
+
+dev_t meminfodev = {
+    .name = "meminfo",
+    .type = CHRDEV,
+    .probe = meminfo_probe,
+    .read = meminfo_read,
+
+    .f_ops = {
+        .open  = generic_file_open,
+        .read  = generic_file_read,
+        .can_read  = __can_always,
+        .can_write = __can_never,
+        .eof = __eof_always,
+    },
+};
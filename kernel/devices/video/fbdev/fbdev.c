@@ -6,6 +6,8 @@
 #include <fs/vfs.h>
 #include <fs/devfs.h>
 
+#include <bits/errno.h>
+
 #define MAX_FBDEV   2
 
 static struct fbdev __registered_fbs[MAX_FBDEV];
@@ -34,6 +36,16 @@ static ssize_t fbdev_write(struct fs_node *node, off_t offset, size_t size, void
     return dev->write(node, offset, size, buf);
 }
 
+static int fbdev_mmap(struct fs_node *node, struct vma *vma)
+{
+    dev_t *dev = ((struct fbdev *)node->p)->dev;
+
+    if (!dev->mmap)
+        return -ENODEV;
+
+    return dev->mmap(node, vma);
+}
+
 static int fbdev_ioctl(struct fs_node *node, int request, void *argp)
 {
     struct fbdev *fb = (struct fbdev *) node->p;
@@ -74,6 +86,7 @@ dev_t fbdev = {
     .read  = fbdev_read,
 	.write = fbdev_write,
     .ioctl  = fbdev_ioctl,
+    .mmap  = fbdev_mmap,
 
 	.f_ops = {
 		.open  = generic_file_open,
@@ -2,6 +2,10 @@
 #include <dev/fbdev.h>
 #include <fs/devfs.h>
 #include <video/vesa.h>
+#include <mm/mm.h>
+#include <mm/vma.h>
+
+#include <bits/errno.h>
 
 static char *vmem = (char *) 0xCA000000;
 
@@ -22,6 +26,26 @@ static ssize_t fbdev_vesa_write(struct fs_node *node, off_t offset, size_t size,
     return size;
 }
 
+/* Map the linear framebuffer itself, user writes go straight to the screen */
+static int fbdev_vesa_mmap(struct fs_node *node, struct vma *vma)
+{
+    struct fbdev *fb = (struct fbdev *) node->p;
+    struct __fbdev_vesa *data = (struct __fbdev_vesa *) fb->data;
+
+    size_t len  = vma->end - vma->start;
+    size_t size = PAGE_ROUND_UP(node->size);
+
+    if ((size_t) vma->off > size || len > size - vma->off)
+        return -EINVAL;
+
+    uintptr_t phys = data->mode_info->phys_base_ptr + vma->off;
+
+    if (!pmman.map_to(phys, vma->start, len, vma->prot | MWC | MIO))
+        return -ENOMEM;
+
+    return 0;
+}
+
 static int fbdev_vesa_prope(int i, struct fbdev *fb)
 {
     struct __fbdev_vesa *data = (struct __fbdev_vesa *) fb->data;
@@ -30,7 +54,14 @@ static int fbdev_vesa_prope(int i, struct fbdev *fb)
     size_t size = info->y_resolution * info->lin_bytes_per_scanline;
 
     char *vmem = (char *) 0xCA000000;
-    pmman.map_to(info->phys_base_ptr, (uintptr_t) vmem, size, KRW);
+
+    /* Map whole 4 MiB frames if the framebuffer is aligned so that it can
+     * be covered with huge pages */
+    size_t map_size = size;
+    if (!(info->phys_base_ptr & TABLE_MASK))
+        map_size = (size + TABLE_MASK) & ~TABLE_MASK;
+
+    pmman.map_to(info->phys_base_ptr, (uintptr_t) vmem, map_size, KRW | MWC | MIO);
 
     fb->dev = &fbdev_vesa;
     fb->fix_screeninfo = &vesa_fix_screeninfo;
@@ -106,4 +137,5 @@ static int fbdev_vesa_prope(int i, struct fbdev *fb)
 dev_t fbdev_vesa = {
     .probe = fbdev_vesa_prope,
     .write = fbdev_vesa_write,
+    .mmap  = fbdev_vesa_mmap,
 };
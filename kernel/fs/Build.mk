@@ -8,3 +8,4 @@ obj-y += write.o
 obj-y += readdir.o
 obj-y += mbr.o
 obj-y += pipe.o
+obj-y += poll.o
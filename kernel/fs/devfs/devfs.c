@@ -72,7 +72,7 @@ static ssize_t devfs_write(struct fs_node *node, off_t offset, size_t size, void
 
 static int devfs_create(struct fs_node *dir, const char *name)
 {
-    struct fs_node *node = kmalloc(sizeof(struct fs_node));
+    struct fs_node *node = kmem_cache_alloc(&fs_node_cache);
 
     if (!node)
         return -ENOMEM;
@@ -105,7 +105,7 @@ e_nomem:    /* Error: No Memory */
     if (node) {
         if (node->name)
             kfree(node->name);
-        kfree(node);
+        kmem_cache_free(&fs_node_cache, node);
     }
 
     if (tmp)
@@ -222,7 +222,7 @@ static int devfs_file_eof(struct file *file)
 int devfs_init()
 {
     //printk("[0] Kernel: devfs -> init()\n");
-    dev_root = kmalloc(sizeof(struct fs_node));
+    dev_root = kmem_cache_alloc(&fs_node_cache);
 
     if (!dev_root)
         return -ENOMEM;
@@ -62,7 +62,7 @@ static int get_pty_id()
 
 static struct fs_node *new_ptm(struct pty *pty)
 {
-    struct fs_node *ptm = kmalloc(sizeof(struct fs_node));
+    struct fs_node *ptm = kmem_cache_alloc(&fs_node_cache);
     memset(ptm, 0, sizeof(struct fs_node));
 
     *ptm = (struct fs_node) {
@@ -235,7 +235,7 @@ int devpts_init()
     devpts.f_ops.open = devfs.f_ops.open;
     devpts.f_ops.readdir = devfs.f_ops.readdir;
 
-    devpts_root = kmalloc(sizeof(struct fs_node));
+    devpts_root = kmem_cache_alloc(&fs_node_cache);
 
     if (!devpts_root)
         return -ENOMEM;
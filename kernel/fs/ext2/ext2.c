@@ -3,6 +3,7 @@
 #include <fs/ext2.h>
 #include <bits/errno.h>
 #include <ds/bitmap.h>
+#include <mm/page_cache.h>
 
 /*
  * Ext 2 Helpers
@@ -23,6 +24,13 @@ typedef struct {
     uint32_t inode;
 } ext2_private_t;
 
+/*
+ * Inodes are read into temporary copies on nearly every lookup, they are
+ * freed with kfree() which hands them back to their cache
+ */
+static struct kmem_cache ext2_inode_cache = KMEM_CACHE_INIT("ext2_inode", sizeof(struct ext2_inode), 0, NULL);
+static struct kmem_cache ext2_private_cache = KMEM_CACHE_INIT("ext2_private", sizeof(ext2_private_t), 0, NULL);
+
 /* ================== Super Block helpers ================== */
 
 static void ext2_superblock_rewrite(ext2_desc_t *desc)
@@ -118,7 +126,7 @@ static struct ext2_inode *ext2_inode_read(ext2_desc_t *desc, uint32_t inode)
 
     uint32_t index = (inode - 1) % desc->superblock->inodes_per_block_group;
     
-    struct ext2_inode *i = kmalloc(sizeof(struct ext2_inode));
+    struct ext2_inode *i = kmem_cache_alloc(&ext2_inode_cache);
     vfs.read(desc->supernode, bgd->inode_table * desc->bs + index * desc->superblock->inode_size, sizeof(*i), i);
     return i;
 }
@@ -250,7 +258,7 @@ static uint32_t ext2_inode_allocate(ext2_desc_t *desc)
 
 static struct fs_node *ext2_inode_to_fs_node(ext2_desc_t *desc, size_t inode)
 {
-    struct fs_node *node = kmalloc(sizeof(struct fs_node));
+    struct fs_node *node = kmem_cache_alloc(&fs_node_cache);
     memset(node, 0, sizeof(*node));
 
     struct ext2_inode *i = ext2_inode_read(desc, inode);
@@ -271,10 +279,11 @@ static struct fs_node *ext2_inode_to_fs_node(ext2_desc_t *desc, size_t inode)
     node->gid  = i->gid;
 
     node->fs   = &ext2fs;
+    node->inode = inode;
 
     kfree(i);
 
-    ext2_private_t *priv = kmalloc(sizeof(ext2_private_t));
+    ext2_private_t *priv = kmem_cache_alloc(&ext2_private_cache);
     priv->inode = inode;
     priv->desc = desc;
     node->p = priv;
@@ -566,6 +575,9 @@ static ssize_t ext2_write(struct fs_node *node, off_t offset, size_t size, void
     size_t bs = p->desc->bs;
     struct ext2_inode *inode = ext2_inode_read(p->desc, p->inode);
 
+    /* Cached copies of the pages are stale from here on */
+    page_cache_invalidate(node, offset, size);
+
     if ((size_t) offset + size > inode->size) {
         inode->size = offset + size;
         ext2_inode_write(p->desc, p->inode, inode);
@@ -33,7 +33,7 @@ void load_ramdisk(module_t *rd_module)
     ramdev_private_t *p = kmalloc(sizeof(ramdev_private_t));
     *p = (ramdev_private_t){.addr = ramdisk};
 
-    ramdisk_dev_node = kmalloc(sizeof(struct fs_node));
+    ramdisk_dev_node = kmem_cache_alloc(&fs_node_cache);
 
     *ramdisk_dev_node = (struct fs_node) {
         .name = "ramdisk",
@@ -56,7 +56,7 @@ static
 struct fs_node *new_node(char *name, enum fs_node_type type, 
     size_t sz, size_t data, struct fs_node *sp)
 {
-    struct fs_node *node = kmalloc(sizeof(struct fs_node));
+    struct fs_node *node = kmem_cache_alloc(&fs_node_cache);
     
     *node = (struct fs_node) {
         .name = name,
@@ -64,6 +64,7 @@ struct fs_node *new_node(char *name, enum fs_node_type type,
         .type = type,
         .fs   = &initramfs,
         .dev  = NULL,
+        .inode = data,  /* Offset in the archive is unique per file */
         .p    = kmalloc(sizeof(cpiofs_private_t))
     };
 
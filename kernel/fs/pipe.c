@@ -30,9 +30,11 @@ static int pipefs_can_write(struct file *file, size_t size)
 	return size >= pipe->ring->size - ring_available(pipe->ring);
 }
 
+static struct kmem_cache pipe_cache = KMEM_CACHE_INIT("pipe", sizeof(struct pipe), 0, NULL);
+
 static struct pipe *pipefs_mkpipe()
 {
-    struct pipe *p = kmalloc(sizeof(struct pipe));
+    struct pipe *p = kmem_cache_alloc(&pipe_cache);
     memset(p, 0, sizeof(struct pipe));
     p->ring = new_ring(PIPE_BUF_LEN);
     return p;
@@ -41,8 +43,11 @@ static struct pipe *pipefs_mkpipe()
 int pipefs_pipe(struct file *read, struct file *write)
 {
     struct pipe *pipe = pipefs_mkpipe();
-    read->node = kmalloc(sizeof(struct fs_node));
-    write->node = kmalloc(sizeof(struct fs_node));
+    read->node = kmem_cache_alloc(&fs_node_cache);
+    write->node = kmem_cache_alloc(&fs_node_cache);
+
+    memset(read->node, 0, sizeof(struct fs_node));
+    memset(write->node, 0, sizeof(struct fs_node));
 
     read->node->read_queue = new_queue();
     write->node->write_queue = read->node->read_queue;
@@ -0,0 +1,113 @@
+/*
+ *          VFS => Generic poll function
+ *
+ *
+ *  This file is part of Aquila OS and is released under
+ *  the terms of GNU GPLv3 - See LICENSE.
+ *
+ */
+
+#include <core/system.h>
+
+#include <fs/vfs.h>
+#include <sys/proc.h>
+#include <sys/sched.h>
+#include <sys/timer.h>
+
+#include <bits/errno.h>
+#include <bits/poll.h>
+
+static short poll_file(struct pollfd *pfd)
+{
+    if (pfd->fd < 0)
+        return 0;
+
+    if (pfd->fd >= FDS_COUNT || !cur_proc->fds[pfd->fd].node)
+        return POLLNVAL;
+
+    struct file *file = &cur_proc->fds[pfd->fd];
+    struct file_ops *ops = &file->node->fs->f_ops;
+    short revents = 0;
+
+    /* Files that can not block are always ready */
+    if (pfd->events & POLLIN) {
+        if (!ops->can_read || ops->can_read(file, 1) > 0 || (ops->eof && ops->eof(file)))
+            revents |= POLLIN;
+    }
+
+    if (pfd->events & POLLOUT) {
+        if (!ops->can_write || ops->can_write(file, 1) > 0)
+            revents |= POLLOUT;
+    }
+
+    return revents;
+}
+
+/* Add or remove the current process to the queues of all polled files */
+static void poll_queues(struct pollfd *fds, size_t nfds, int add)
+{
+    for (size_t i = 0; i < nfds; ++i) {
+        if (fds[i].fd < 0 || fds[i].fd >= FDS_COUNT || !cur_proc->fds[fds[i].fd].node)
+            continue;
+
+        struct fs_node *node = cur_proc->fds[fds[i].fd].node;
+        queue_t *queues[] = {
+            fds[i].events & POLLIN  ? node->read_queue  : NULL,
+            fds[i].events & POLLOUT ? node->write_queue : NULL,
+        };
+
+        for (size_t j = 0; j < 2; ++j) {
+            if (!queues[j])
+                continue;
+
+            if (add)
+                enqueue(queues[j], cur_proc);
+            else
+                queue_remove(queues[j], cur_proc);
+        }
+    }
+}
+
+/**
+ * generic_poll
+ *
+ * Waits for one of `fds' to be ready for the I/O in its `events'.
+ * Conforming to `IEEE Std 1003.1, 2013 Edition'
+ *
+ * @fds     Files to wait on.
+ * @nfds    Number of entries in `fds'.
+ * @timeout In milliseconds, -1 waits forever.
+ * @returns number of ready files, 0 on timeout, or error-code on failure.
+ */
+
+int generic_poll(struct pollfd *fds, size_t nfds, int timeout)
+{
+    uint64_t expires = jiffies + (timeout > 0 ? (timeout + TICK_MSEC - 1) / TICK_MSEC + 1 : 0);
+
+    for (;;) {
+        int ready = 0;
+
+        for (size_t i = 0; i < nfds; ++i) {
+            fds[i].revents = poll_file(&fds[i]);
+
+            if (fds[i].revents)
+                ++ready;
+        }
+
+        if (ready || !timeout || (timeout > 0 && jiffies >= expires))
+            return ready;
+
+        /* Any reader or writer waking up the queues wakes us up */
+        poll_queues(fds, nfds, 1);
+
+        int ret = timeout > 0 ? sleep_on_timeout(NULL, expires - jiffies) : sleep_on(NULL);
+
+        poll_queues(fds, nfds, 0);
+
+        if (ret == -ETIMEDOUT)
+            return 0;
+
+        if (ret)
+            return -EINTR;
+    }
+}
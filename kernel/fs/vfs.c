@@ -1,12 +1,15 @@
 #include <core/system.h>
 #include <core/string.h>
 #include <mm/mm.h>
+#include <mm/slab.h>
 #include <fs/vfs.h>
 #include <sys/proc.h>
 #include <sys/sched.h>
 #include <bits/fcntl.h>
 #include <bits/errno.h>
 
+struct kmem_cache fs_node_cache = KMEM_CACHE_INIT("fs_node", sizeof(struct fs_node), SLAB_CACHE_LINE, NULL);
+
 /* List of registered filesystems */
 struct fs_list {
     const char *name;
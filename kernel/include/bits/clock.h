@@ -0,0 +1,23 @@
+#ifndef _BITS_CLOCK_H
+#define _BITS_CLOCK_H
+
+#include <stdint.h>
+
+/*
+ *  Clock data page, mapped read-only in every process so the time can be
+ *  read without a system call. Readers retry while `seq' is odd or changed
+ *  under them, then add the TSC cycles since `tsc_base'.
+ */
+
+struct clock_data {
+    uint32_t seq;       /* Odd while the kernel updates it */
+    uint32_t tsc_mult;  /* ns = cycles * tsc_mult >> tsc_shift, 0 without a TSC */
+    uint32_t tsc_shift;
+    uint32_t boot_time; /* Seconds since the Epoch at boot, from the RTC */
+    uint64_t tsc_base;  /* TSC at the last update */
+    uint32_t mono_sec;  /* CLOCK_MONOTONIC at the last update */
+    uint32_t mono_nsec;
+    uint64_t jiffies;
+};
+
+#endif /* ! _BITS_CLOCK_H */
@@ -0,0 +1,17 @@
+#ifndef _POLL_H
+#define _POLL_H
+
+struct pollfd {
+    int   fd;
+    short events;
+    short revents;
+};
+
+#define POLLIN      0x01
+#define POLLPRI     0x02
+#define POLLOUT     0x04
+#define POLLERR     0x08
+#define POLLHUP     0x10
+#define POLLNVAL    0x20
+
+#endif /* ! _POLL_H */
@@ -0,0 +1,33 @@
+#ifndef _TIME_H
+#define _TIME_H
+
+struct timeval {
+    long tv_sec;
+    long tv_usec;
+};
+
+struct timespec {
+    long tv_sec;
+    long tv_nsec;
+};
+
+struct itimerval {
+    struct timeval it_interval;
+    struct timeval it_value;
+};
+
+struct tms {
+    unsigned long tms_utime;
+    unsigned long tms_stime;
+    unsigned long tms_cutime;
+    unsigned long tms_cstime;
+};
+
+/* Units of struct tms and times(), as CLOCKS_PER_SEC in libc */
+#define CLK_TCK     1000
+
+#define ITIMER_REAL     0
+#define ITIMER_VIRTUAL  1
+#define ITIMER_PROF     2
+
+#endif /* ! _TIME_H */
@@ -6,6 +6,7 @@
 #define ARCH_BITS 32
 //#define X86_PAE	1
 #define MULTIBOOT_GFX   1
+#define HZ  100     /* Scheduler tick frequency */
 
 
 #define UTSNAME_SYSNAME  "AquilaOS"
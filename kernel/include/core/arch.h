@@ -14,11 +14,15 @@ void arch_load_elf_end(void *arch);
 /* arch/ARCH/sys/proc.c */
 void arch_init_proc(void *arch, proc_t *proc);
 void arch_spawn_proc(proc_t *init);
-void arch_switch_proc(proc_t *proc) __attribute__((noreturn));
+void arch_switch_proc(proc_t *prev, proc_t *next);
+void arch_reap_proc(proc_t *proc);
 void arch_sleep();
+void arch_switch_mm(proc_t *proc);
 
 /* arch/ARCH/sys/fork.c */
 int arch_sys_fork(proc_t *proc);
+int arch_sys_vfork(proc_t *proc);
+int arch_vfork_release(proc_t *proc, int exec);
 
 /* arch/ARCH/sys/syscall.c */
 void arch_syscall_return(proc_t *proc, uintptr_t val);
@@ -30,6 +34,9 @@ void arch_sched();
 /* arch/ARCH/sys/execve.c */
 void arch_sys_execve(proc_t *proc, int argc, char * const argp[], int envc, char * const envp[]);
 
-void arch_idle();
+/* arch/ARCH/mm */
+struct meminfo;
+void arch_meminfo(struct meminfo *info);
+size_t arch_proc_rss(proc_t *proc);
 
 #endif /* ! _ARCH_H */
@@ -11,6 +11,8 @@ typedef enum
 
 typedef struct device dev_t;
 
+struct vma;
+
 #include <fs/vfs.h>
 #include <sys/proc.h>
 
@@ -22,6 +24,7 @@ struct device
 	ssize_t		(*read) (struct fs_node * dev, off_t offset, size_t size, void * buf);
 	ssize_t		(*write)(struct fs_node * dev, off_t offset, size_t size, void * buf);
 	int			(*ioctl)(struct fs_node * dev, int request, void * argp);
+	int			(*mmap) (struct fs_node * dev, struct vma * vma);
 
 	/* File Operations */
 	struct file_ops f_ops;
@@ -39,5 +42,6 @@ extern dev_t ttydev;
 extern dev_t pcidev;
 extern dev_t atadev;
 extern dev_t fbdev;
+extern dev_t meminfodev;
 
 #endif
@@ -4,12 +4,31 @@
 #include <core/system.h>
 #include <ds/bitmap.h>
 
+/*
+ * Each order keeps a doubly linked list of its free blocks, the links are
+ * stored out of band in an array indexed by the frame number of the block
+ * head. The bitmap is only consulted when coalescing, a clear bit means the
+ * block is free and on the free list of its order.
+ */
+
+struct buddy_link {
+    uint32_t prev;
+    uint32_t next;
+};
+
 struct buddy {
-	size_t first_free_idx;
-    size_t usable;
+    uint32_t free_list;     /* Frame number of first free block */
+    size_t usable;          /* Number of free blocks */
 	bitmap_t bitmap;
 };
 
+#define BUDDY_MAX_ORDER (10)
+#define BUDDY_MIN_BS (4096)
+#define BUDDY_MAX_BS (BUDDY_MIN_BS << BUDDY_MAX_ORDER)
+
 #define BUDDY_IDX(idx) ((idx) ^ 0x1)
+#define BUDDY_NIL ((uint32_t) -1)
+
+extern struct buddy buddies[BUDDY_MAX_ORDER+1];
 
 #endif /* ! _BUDDY_H */
@@ -5,6 +5,7 @@
 #include <core/string.h>
 #include <core/printk.h>
 #include <mm/mm.h>
+#include <mm/slab.h>
 
 typedef struct queue queue_t;
 struct queue_node {
@@ -18,9 +19,13 @@ struct queue {
 	struct queue_node *tail;
 } __packed;
 
+/* mm/slab.c */
+extern struct kmem_cache queue_node_cache;
+extern struct kmem_cache queue_cache;
+
 static inline void enqueue(queue_t *queue, void *value) 
 {
-	struct queue_node *node = kmalloc(sizeof(struct queue_node));
+	struct queue_node *node = kmem_cache_alloc(&queue_node_cache);
 	node->value = value;
 	node->next = NULL;
 
@@ -42,8 +47,12 @@ static inline void *dequeue(queue_t *queue)
 	--queue->count;
 	struct queue_node *head = queue->head;
 	queue->head = queue->head->next;
+
+	if (!queue->count)
+		queue->tail = NULL;
+
 	void *value = head->value;
-	kfree(head);
+	kmem_cache_free(&queue_node_cache, head);
 	return value;
 }
 
@@ -61,11 +70,11 @@ static inline void queue_remove(queue_t *queue, void *value)
                 --queue->count;
                 queue->tail = prev;
                 prev->next = NULL;
-                kfree(node);
+                kmem_cache_free(&queue_node_cache, node);
             } else {
                 --queue->count;
                 prev->next = node->next;
-                kfree(node);
+                kmem_cache_free(&queue_node_cache, node);
             }
 
             break;
@@ -74,9 +83,18 @@ static inline void queue_remove(queue_t *queue, void *value)
     }
 }
 
+/* Queues come out of queue_cache zeroed, and must be freed empty */
 static inline void *new_queue()
 {
-	return memset(kmalloc(sizeof(queue_t)), 0, sizeof(queue_t));
+	return kmem_cache_alloc(&queue_cache);
+}
+
+static inline void free_queue(queue_t *queue)
+{
+	while (queue->count)
+		dequeue(queue);
+
+	kmem_cache_free(&queue_cache, queue);
 }
 
 #define NEW_QUEUE &(struct queue){0}
@@ -96,6 +96,7 @@ struct fs_node
     dev_t       *dev;
     off_t       offset; /* Offset to add to each operation on node */
     void        *p;     /* Filesystem handler private data */
+    size_t      inode;  /* Unique within `fs', 0 if not cacheable */
 
     uint32_t    mask;   /* File access mask */
     uint32_t    uid;    /* User ID */
@@ -141,6 +142,9 @@ typedef struct
 } vfs_mountpoint_t;
 
 
+/* fs/vfs.c */
+extern struct kmem_cache fs_node_cache;
+
 extern struct vfs vfs;
 extern struct fs_node *vfs_root;
 
@@ -156,6 +160,10 @@ ssize_t generic_file_write(struct file *file, void *buf, size_t size);
 /* kernel/fs/readdir.c */
 ssize_t generic_file_readdir(struct file *file, struct dirent *dirnet);
 
+/* kernel/fs/poll.c */
+struct pollfd;
+int generic_poll(struct pollfd *fds, size_t nfds, int timeout);
+
 static inline int __eof_always(struct file *f __unused){return 1;}
 static inline int __eof_never (struct file *f __unused){return 0;}
 static inline int __can_always(struct file *f __unused, size_t s __unused){return 1;}
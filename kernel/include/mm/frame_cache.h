@@ -0,0 +1,36 @@
+#ifndef _FRAME_CACHE_H
+#define _FRAME_CACHE_H
+
+#include <core/system.h>
+
+#define FRAME_CACHE_CPUS    (32)
+#define FRAME_CACHE_HIGH    (64)    /* Maximum frames kept per CPU */
+#define FRAME_CACHE_BATCH   (16)    /* Frames moved per refill/drain */
+
+/*
+ * Per-CPU cache of order-0 frames in front of the buddy allocator.
+ * Frames are kept in a ring, hot frames (recently freed, likely still in
+ * the CPU cache) are pushed and popped at the front, cold frames are
+ * pushed at the back, and the back is what gets drained.
+ */
+
+struct frame_cache {
+    uintptr_t frames[FRAME_CACHE_HIGH];
+    size_t head;
+    size_t count;
+
+    /* Statistics */
+    size_t hits;
+    size_t misses;
+    size_t refills;
+    size_t drains;
+};
+
+extern struct frame_cache frame_caches[FRAME_CACHE_CPUS];
+
+uintptr_t frame_cache_alloc();
+void frame_cache_free(uintptr_t frame, int cold);
+void frame_cache_drain_all();
+void frame_cache_dump();
+
+#endif /* ! _FRAME_CACHE_H */
@@ -0,0 +1,31 @@
+#ifndef _MEMINFO_H
+#define _MEMINFO_H
+
+#include <core/system.h>
+#include <ds/buddy.h>
+
+/*
+ * Snapshot of memory usage, frame counts are in pages and everything else
+ * in bytes. Free frames are the ones sitting in the buddy system, the
+ * frame caches and the zero pool, everything else is in use.
+ */
+
+struct meminfo {
+    size_t total;       /* Managed frames */
+    size_t free;        /* Free frames in the buddy system */
+    size_t free_blocks[BUDDY_MAX_ORDER+1];  /* Free blocks per order */
+    size_t cached;      /* Free frames in the per-CPU frame caches */
+    size_t zeroed;      /* Free frames in the zero pool */
+    size_t used;        /* Frames in use */
+
+    size_t page_tables; /* Frames used as page tables */
+    size_t cow_shared;  /* Frames mapped copy-on-write by more than one process */
+    size_t page_cache;  /* Frames holding cached file pages */
+
+    size_t slab;        /* Bytes held by slab caches */
+    size_t vmalloc;     /* Bytes handed out by vmalloc */
+};
+
+void meminfo_get(struct meminfo *info);
+
+#endif /* ! _MEMINFO_H */
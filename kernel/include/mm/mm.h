@@ -26,12 +26,22 @@
 #define UWX	(UW|UX)	/* User Write/eXecute */
 #define URWX	(UR|UW|UX)	/* User Read/Write/eXecute */
 
+#define MWC	_BV(6)	/* Write-Combining memory type (if supported) */
+#define MIO	_BV(7)	/* I/O memory, not backed by page frames */
+#define MUC	_BV(8)	/* Uncacheable memory type, for device registers */
+
+/* Page fault causes, passed to handle_page_fault */
+#define PF_PRESENT	_BV(0)	/* Page was present, protection violation */
+#define PF_WRITE	_BV(1)	/* Faulting access was a write */
+#define PF_USER	_BV(2)	/* Fault happened in user mode */
+
 typedef struct
 {
 	int		(*map)(uintptr_t addr, size_t size, int flags);
 	int		(*map_to)(uintptr_t phys, uintptr_t virt, size_t size, int flags);
 	void	(*unmap)(uintptr_t addr, size_t size);
 	void	(*unmap_full)(uintptr_t addr, size_t size);
+	void	(*protect)(uintptr_t addr, size_t size, int flags);
 #if 0
 	void*	(*memcpypp)(void *phys_dest, void *phys_src, size_t n);	/* Phys to Phys memcpy */
 #endif
@@ -40,7 +50,7 @@ typedef struct
 	void*	(*memcpypp)(uintptr_t phys_dest, uintptr_t phys_src, size_t n);	/* Phys to Phys memcpy */
     void    (*switch_mapping)(uintptr_t structue);
     void    (*copy_fork_mapping)(uintptr_t base, uintptr_t fork);
-    void    (*handle_page_fault)(uintptr_t addr);
+    void    (*handle_page_fault)(uintptr_t addr, int err);
 } pmman_t;
 
 struct paging
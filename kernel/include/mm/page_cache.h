@@ -0,0 +1,30 @@
+#ifndef _PAGE_CACHE_H
+#define _PAGE_CACHE_H
+
+#include <core/system.h>
+
+/*
+ * Cache of file pages keyed by (fs, inode, page offset). The cache holds
+ * one reference on each frame, every mapping of it holds another, so a
+ * frame outlives its cache entry as long as it is mapped somewhere.
+ */
+
+#define PAGE_CACHE_BUCKETS  (256)
+
+struct fs_node;
+
+struct cached_page {
+    struct fs *fs;
+    size_t inode;
+    off_t off;          /* Page aligned offset in file */
+    uintptr_t frame;    /* Physical address of the data */
+
+    struct cached_page *next;
+};
+
+extern size_t page_cache_pages;
+
+uintptr_t page_cache_get(struct fs_node *node, off_t off);
+void page_cache_invalidate(struct fs_node *node, off_t off, size_t size);
+
+#endif /* ! _PAGE_CACHE_H */
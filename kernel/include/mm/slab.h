@@ -0,0 +1,89 @@
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <core/system.h>
+#include <mm/mm.h>
+
+/*
+ * Slab allocator
+ *
+ * Every cache hands out objects of a single size carved out of slabs,
+ * a slab is a naturally aligned virtually contiguous chunk of 2^order
+ * pages with its descriptor at the beginning, so the slab owning an
+ * object is found by masking the object address.
+ */
+
+#define SLAB_MAX_ORDER      (3)
+#define SLAB_EMPTY_MAX      (1)     /* Empty slabs kept around per cache */
+#define SLAB_BUFCTL_END     (0xFFFF)
+#define SLAB_CACHE_LINE     (64)    /* Alignment for cache-line aligned caches */
+
+struct kmem_cache;
+
+struct slab {
+    struct kmem_cache *cache;
+    struct slab *prev;
+    struct slab *next;
+    char *mem;          /* First object */
+    size_t inuse;       /* Allocated objects */
+    uint16_t free;      /* Index of first free object */
+    uint16_t bufctl[];  /* Index of next free object, for each object */
+};
+
+/*
+ * Objects are handed out in their constructed state, the constructor is
+ * only called when a new slab is created, so objects must be returned to
+ * the cache in the same state.
+ */
+
+struct kmem_cache {
+    const char *name;
+    size_t size;        /* Object size */
+    size_t align;       /* Object alignment */
+    void (*ctor)(void *obj);
+    size_t order;       /* Slab is (PAGE_SIZE << order) bytes */
+    size_t objs;        /* Objects per slab */
+
+    struct slab *partial;
+    struct slab *full;
+    struct slab *empty;
+    size_t nr_empty;
+
+    /* Statistics */
+    size_t active;      /* Allocated objects */
+    size_t nr_slabs;    /* Slabs owned by the cache */
+    size_t allocs;      /* Total allocations */
+    size_t frees;       /* Total frees */
+
+    struct kmem_cache *next;    /* All caches list */
+};
+
+/* Memory held by the cache, in bytes */
+#define KMEM_CACHE_BYTES(cache) ((cache)->nr_slabs * (PAGE_SIZE << (cache)->order))
+
+#define KMEM_CACHE_INIT(_name, _size, _align, _ctor) \
+    {.name = (_name), .size = (_size), .align = (_align), .ctor = (_ctor)}
+
+#define IS_SLAB_ADDR(ptr) \
+    ((uintptr_t) (ptr) >= SLAB_BASE && (uintptr_t) (ptr) < SLAB_BASE + SLAB_SIZE)
+
+#define KMALLOC_MIN_SIZE    (16)
+#define KMALLOC_MAX_SIZE    (2048)
+
+/* All set up caches, linked through `next' */
+extern struct kmem_cache *kmem_caches;
+
+void slab_setup();
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align, void (*ctor)(void *));
+void *kmem_cache_alloc(struct kmem_cache *cache);
+void kmem_cache_free(struct kmem_cache *cache, void *obj);
+
+/* Allocate from the general purpose power-of-two caches */
+void *kmem_alloc(size_t size);
+/* Free an object from any cache */
+void kmem_free(void *obj);
+
+void kmem_cache_dump();
+
+#endif /* ! _SLAB_H */
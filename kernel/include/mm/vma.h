@@ -0,0 +1,58 @@
+#ifndef _VMA_H
+#define _VMA_H
+
+#include <core/system.h>
+#include <mm/mm.h>
+
+/*
+ * Virtual memory areas of a process, kept in a list sorted by address.
+ * Each area is page aligned and describes how faults in it are resolved,
+ * `prot' uses the UR/UW/UX paging flags.
+ */
+
+/* Backing */
+#define VMA_ANON    0   /* Zero filled on demand */
+#define VMA_FILE    1   /* Filled from `node' at `off' */
+#define VMA_DEVICE  2   /* Mapped by the device driver */
+
+/* Flags */
+#define VMA_IMAGE   _BV(0)  /* Loaded from the executable */
+#define VMA_HEAP    _BV(1)  /* Grown and shrunk by sbrk */
+#define VMA_STACK   _BV(2)
+#define VMA_SHARED  _BV(3)  /* Pages are shared with children, never copy-on-write */
+
+struct fs_node;
+
+struct vma {
+    uintptr_t start;    /* First byte of the area */
+    uintptr_t end;      /* First byte after the area */
+    int prot;
+    int flags;
+    int type;
+
+    struct fs_node *node;
+    off_t off;
+    size_t filesz;      /* Bytes backed by `node' from `start', the rest is zeros */
+
+    struct vma *next;
+};
+
+#define PAGE_ROUND_UP(x)    (((x) + PAGE_MASK) & ~PAGE_MASK)
+#define PAGE_ROUND_DOWN(x)  ((x) & ~PAGE_MASK)
+
+extern struct kmem_cache vma_cache;
+
+struct vma *vma_find(struct vma *list, uintptr_t addr);
+struct vma *vma_find_flags(struct vma *list, int flags);
+struct vma *vma_insert(struct vma **list, uintptr_t start, uintptr_t end, int prot, int flags, int type);
+int vma_dup(struct vma **dst, struct vma *src);
+int vma_brk(struct vma *list, uintptr_t brk);
+void vma_unmap_all(struct vma **list);
+void vma_free_all(struct vma **list);
+
+/* mm/mmap.c */
+uintptr_t vma_mmap(uintptr_t addr, size_t len, int prot, int flags, int fildes, off_t off);
+int vma_munmap(uintptr_t addr, size_t len);
+int vma_mprotect(uintptr_t addr, size_t len, int prot);
+
+#endif /* ! _VMA_H */
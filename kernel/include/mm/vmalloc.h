@@ -0,0 +1,35 @@
+#ifndef _VMALLOC_H
+#define _VMALLOC_H
+
+#include <core/system.h>
+#include <mm/mm.h>
+
+/*
+ * Allocator for large, page granular, kernel objects
+ *
+ * Every area gets its own range in [VMALLOC_BASE, VMALLOC_END) preceded by
+ * an unmapped guard page. Pages are mapped on first touch unless the area
+ * is prefaulted, kernel stacks must be since we can't take a page fault
+ * without a stack to push the exception frame on.
+ */
+
+#define VM_PREFAULT _BV(0)  /* Map all pages on allocation */
+#define VM_STACK    _BV(1)  /* Kernel stack, implies VM_PREFAULT */
+
+struct vm_area {
+    uintptr_t addr;     /* Start of area, including guard page */
+    size_t size;        /* Size of area, including guard page */
+    int flags;
+    struct vm_area *next;
+};
+
+#define IS_VMALLOC_ADDR(ptr) \
+    ((uintptr_t) (ptr) >= VMALLOC_BASE && (uintptr_t) (ptr) < VMALLOC_END)
+
+extern size_t vmalloc_used;
+
+void *vmalloc(size_t size, int flags);
+void vfree(void *ptr);
+int vmalloc_fault(uintptr_t addr);
+
+#endif /* ! _VMALLOC_H */
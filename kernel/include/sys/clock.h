@@ -0,0 +1,22 @@
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+#include <core/system.h>
+#include <bits/clock.h>
+
+#define NSEC_PER_SEC    1000000000UL
+
+/* A free running counter the time is interpolated with between ticks */
+struct clock_source {
+    const char *name;
+    uint64_t (*read)();
+    uint32_t mult;  /* ns = count * mult >> shift */
+    uint32_t shift;
+};
+
+extern struct clock_data *clock_data;
+
+void clock_init(struct clock_source *cs, uint32_t boot_time);
+void clock_update();
+
+#endif /* ! _CLOCK_H */
@@ -16,6 +16,13 @@
 #define SHF_ALLOC	0x2
 #define SHF_EXEC	0x4
 
+#define PT_NULL		0
+#define PT_LOAD		1
+
+#define PF_X		0x1
+#define PF_W		0x2
+#define PF_R		0x4
+
 typedef struct
 {
 	uint8_t  magic[4];
@@ -54,6 +61,18 @@ typedef struct
 	uint32_t entsize;
 } elf32_section_hdr_t;
 
+typedef struct
+{
+	uint32_t type;
+	uint32_t off;
+	uint32_t vaddr;
+	uint32_t paddr;
+	uint32_t filesz;
+	uint32_t memsz;
+	uint32_t flags;
+	uint32_t align;
+} elf32_program_hdr_t;
+
 typedef struct
 {
 	uint8_t  magic[4];
@@ -94,6 +113,6 @@ typedef struct
 
 /* sys/elf.c */
 proc_t *load_elf(const char *fn);
-proc_t *load_elf_proc(proc_t *proc, const char *fn);
+int load_elf_proc(proc_t *proc, const char *fn);
 
 #endif
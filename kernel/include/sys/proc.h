@@ -4,6 +4,7 @@
 #include <core/system.h>
 #include <fs/vfs.h>
 #include <ds/queue.h>
+#include <sys/timer.h>
 
 #if ARCH == X86
 #include <arch/x86/include/proc.h>
@@ -18,6 +19,8 @@ typedef enum {
 	ZOMBIE,
 } state_t;
 
+struct vma;
+
 typedef struct proc proc_t;
 struct proc {
 	pid_t 		pid;	/* Process identifier */
@@ -29,6 +32,7 @@ struct proc {
 	uintptr_t	heap_start;	/* Process initial heap pointer */
 	uintptr_t	heap;	/* Process heap pointer */
 	uintptr_t	entry;	/* Process entry point */	
+	struct vma	*vmas;	/* Memory areas, sorted by address */
 
     struct {
         uintptr_t start;    /* Start of process image in memory */
@@ -40,19 +44,45 @@ struct proc {
     uintptr_t   signal_handler[22];
 
     queue_t     wait_queue; /* Dummy queue for children wait */
+    queue_t     *sleep_queue;   /* Queue we are sleeping on, if any */
+    struct timer sleep_timer;   /* Timeout of the current sleep */
+
+    struct timer itimer;    /* ITIMER_REAL, raises SIGALRM */
+    uint32_t    itimer_interval;    /* in ticks, 0 if one-shot */
     int         exit_status; /* Exit status of child if zombie */
 
+    /* CPU time in ticks, see sys_times */
+    uint32_t    utime;  /* In user mode */
+    uint32_t    stime;  /* In the kernel */
+    uint32_t    cutime; /* utime of waited for children */
+    uint32_t    cstime; /* stime of waited for children */
+
+    /* Scheduling, see sys/sched.c */
+    int         nice;   /* NICE_MIN to NICE_MAX */
+    int         boost;  /* Interactivity bonus */
+    int         slice_used;     /* Ticks of its time slice used up */
+    proc_t      *sched_next;    /* Next in its run queue */
+
 	/* Process flags */
 	int			spawned : 1;
+	int			vforked : 1;	/* Running in the parent's address space */
+	int			vfork_lent : 1;	/* A vfork child runs in ours, signals are held */
+	int			ready : 1;	/* Queued in a run queue */
 } __packed;
 
 /* sys/fork.c */
 proc_t *fork_proc(proc_t *proc);
+proc_t *vfork_proc(proc_t *proc);
+int vfork_release(proc_t *proc, int exec);
 
 /* sys/execve.c */
-proc_t *execve_proc(proc_t *proc, const char *fn, char * const argv[], char * const env[]);
+int execve_proc(proc_t *proc, const char *fn, char * const argv[], char * const env[]);
+int posix_spawn_proc(proc_t *proc, const char *fn, char * const argv[], char * const env[]);
 
 /* sys/proc.c */
+extern struct kmem_cache proc_cache;
+extern struct kmem_cache fds_cache;
+
 proc_t *new_proc();
 proc_t *get_proc_by_pid(pid_t pid);
 void kill_proc(proc_t *proc);
@@ -63,7 +93,9 @@ void release_fd(proc_t *proc, int fd);
 
 int get_pid();
 void init_process(proc_t *proc);
+void proc_timers_init(proc_t *proc);
 int sleep_on(queue_t *queue);
+int sleep_on_timeout(queue_t *queue, uint32_t ticks);
 void wakeup_queue(queue_t *queue);
 
 #endif /* !_PROC_H */
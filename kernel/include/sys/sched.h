@@ -3,17 +3,21 @@
 
 #include <core/system.h>
 #include <sys/proc.h>
-#include <ds/queue.h>
 
-extern queue_t *ready_queue;
+#define NICE_MIN    (-20)   /* Highest priority */
+#define NICE_MAX    (19)    /* Lowest priority */
+
 extern proc_t *cur_proc;
+extern int need_resched;
+extern volatile uint64_t jiffies;   /* Timer ticks since the scheduler started */
 
 extern int kidle;
-void kernel_idle();
 void scheduler_init();
 void spawn_proc(proc_t *proc);
 void spawn_init(proc_t *init);
 void schedule();
 void make_ready(proc_t *proc);
+void sched_tick(int user);
+int sched_nice(proc_t *proc, int incr);
 
 #endif /* ! _SCHED_H */
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define _SIGNAL_H
 
 #include <core/system.h>
+#include <sys/proc.h>
+#include <bits/time.h>
 
 /* Signal numbers */
 #define	SIGHUP	1	/* hangup */
@@ -43,6 +45,10 @@
 extern int sig_default_action[];
 
 int send_signal(int pid, int sig);
+void signal_proc(proc_t *proc, int sig);
 void arch_handle_signal(int sig);
 
+void itimer_init(proc_t *proc);
+int itimer_set(proc_t *proc, const struct itimerval *value, struct itimerval *ovalue);
+
 #endif /* ! _SIGNAL_H */
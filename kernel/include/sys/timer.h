@@ -0,0 +1,59 @@
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include <core/system.h>
+#include <bits/time.h>
+
+struct timer {
+    uint64_t expires;   /* in jiffies */
+    void (*fn)(void *arg);
+    void *arg;
+
+    struct timer *next;
+    struct timer **pprev;   /* NULL if not pending */
+};
+
+#define TICK_USEC   (1000000 / HZ)
+#define TICK_NSEC   (1000000000 / HZ)
+#define TICK_MSEC   (1000 / HZ)
+
+/* Longest delay a timer can be armed for, longer ones are clamped */
+#define TIMER_MAX_TICKS 0xFFFFFFFFUL
+
+/* Conversions round up, a timer never fires early */
+static inline uint32_t timeval_to_ticks(const struct timeval *tv)
+{
+    uint32_t sec = MIN((uint32_t) tv->tv_sec, TIMER_MAX_TICKS / HZ - 1);
+    return sec * HZ + (tv->tv_usec + TICK_USEC - 1) / TICK_USEC;
+}
+
+static inline uint32_t timespec_to_ticks(const struct timespec *ts)
+{
+    uint32_t sec = MIN((uint32_t) ts->tv_sec, TIMER_MAX_TICKS / HZ - 1);
+    return sec * HZ + (ts->tv_nsec + TICK_NSEC - 1) / TICK_NSEC;
+}
+
+static inline void ticks_to_timeval(uint32_t ticks, struct timeval *tv)
+{
+    tv->tv_sec  = ticks / HZ;
+    tv->tv_usec = (ticks % HZ) * TICK_USEC;
+}
+
+static inline void ticks_to_timespec(uint32_t ticks, struct timespec *ts)
+{
+    ts->tv_sec  = ticks / HZ;
+    ts->tv_nsec = (ticks % HZ) * TICK_NSEC;
+}
+
+static inline int timer_pending(struct timer *timer)
+{
+    return !!timer->pprev;
+}
+
+void timer_init(struct timer *timer, void (*fn)(void *), void *arg);
+void timer_add(struct timer *timer, uint64_t expires);
+int  timer_del(struct timer *timer);
+void timer_run();
+uint64_t timer_next();
+
+#endif /* ! _TIMER_H */
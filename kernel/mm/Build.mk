@@ -1,2 +1,9 @@
 obj-y += pmm.o
 obj-y += buddy.o
+obj-y += frame_cache.o
+obj-y += slab.o
+obj-y += vmalloc.o
+obj-y += meminfo.o
+obj-y += vma.o
+obj-y += mmap.o
+obj-y += page_cache.o
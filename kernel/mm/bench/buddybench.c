@@ -0,0 +1,188 @@
+/**********************************************************************
+ *                  Buddy Allocator Microbenchmark
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+/*
+ *  Runs mm/buddy.c on the host, include/ here stands in for the kernel
+ *  headers it needs. Only the allocator's bookkeeping is exercised, the
+ *  "physical memory" it hands out is never touched.
+ *
+ *  Build and run from this directory:
+ *      cc -O2 -I include -idirafter ../../include buddybench.c ../buddy.c -o buddybench
+ *      ./buddybench [rounds]
+ *
+ *  Reports ns per buddy_alloc/buddy_free for every order, with blocks freed
+ *  in random order, then for a fork/exit mix: processes come and go at
+ *  random, each holding a page directory, page tables, an 8 KiB kernel
+ *  stack and a varying number of pages.
+ */
+
+#include <core/system.h>
+#include <ds/buddy.h>
+#include <time.h>
+
+#define BENCH_MEM       (256UL * 1024 * 1024)   /* Simulated RAM */
+#define BENCH_HEAP      (1024 * 1024)           /* Boot heap for the bitmaps */
+#define DEFAULT_ROUNDS  20
+#define MAX_BLOCKS      4096
+
+#define NR_PROCS        32      /* Live processes in the fork/exit mix */
+#define PROC_FRAMES     256     /* Upper bound of frames per process */
+
+char *bench_mem = NULL;
+char *kernel_heap = NULL;
+
+uintptr_t buddy_alloc(size_t size);
+void buddy_free(uintptr_t addr, size_t size);
+void buddy_setup(size_t total_mem);
+
+static uintptr_t blocks[MAX_BLOCKS];
+
+struct bench_proc {
+    uintptr_t pd;
+    uintptr_t kstack;
+    size_t nr_frames;
+    uintptr_t frames[PROC_FRAMES];
+};
+
+static struct bench_proc procs[NR_PROCS];
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void shuffle(uintptr_t *v, size_t n)
+{
+    for (size_t i = n - 1; i > 0; --i) {
+        size_t j = rand() % (i + 1);
+        uintptr_t t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+    }
+}
+
+static void bench_order(size_t order, int rounds)
+{
+    size_t size = BUDDY_MIN_BS << order;
+    uint64_t alloc_ns = 0, free_ns = 0, ops = 0;
+
+    for (int r = 0; r < rounds; ++r) {
+        size_t n = 0;
+        uint64_t start = now_ns();
+
+        while (n < MAX_BLOCKS && (blocks[n] = buddy_alloc(size)))
+            ++n;
+
+        alloc_ns += now_ns() - start;
+
+        shuffle(blocks, n);
+
+        start = now_ns();
+
+        for (size_t i = 0; i < n; ++i)
+            buddy_free(blocks[i], size);
+
+        free_ns += now_ns() - start;
+        ops += n;
+    }
+
+    printf("%2d  %7d  %9.1f  %9.1f\n", (int) order, (int) (ops / rounds),
+            (double) alloc_ns / ops, (double) free_ns / ops);
+}
+
+static size_t proc_fork(struct bench_proc *p)
+{
+    p->pd = buddy_alloc(BUDDY_MIN_BS);
+    p->kstack = buddy_alloc(2 * BUDDY_MIN_BS);
+    p->nr_frames = 0;
+
+    /* Page tables and the pages copied or faulted in */
+    size_t want = 8 + rand() % (PROC_FRAMES - 8);
+
+    while (p->nr_frames < want && (p->frames[p->nr_frames] = buddy_alloc(BUDDY_MIN_BS)))
+        ++p->nr_frames;
+
+    return p->nr_frames + 2;
+}
+
+static size_t proc_exit(struct bench_proc *p)
+{
+    /* Pages go back in no particular order, like vma_unmap_all then reap */
+    shuffle(p->frames, p->nr_frames);
+
+    for (size_t i = 0; i < p->nr_frames; ++i)
+        buddy_free(p->frames[i], BUDDY_MIN_BS);
+
+    buddy_free(p->kstack, 2 * BUDDY_MIN_BS);
+    buddy_free(p->pd, BUDDY_MIN_BS);
+
+    return p->nr_frames + 2;
+}
+
+static void bench_fork_exit(int rounds)
+{
+    uint64_t ops = 0;
+
+    for (int i = 0; i < NR_PROCS; ++i)
+        proc_fork(&procs[i]);
+
+    uint64_t start = now_ns();
+
+    for (int r = 0; r < rounds * 1000; ++r) {
+        struct bench_proc *p = &procs[rand() % NR_PROCS];
+        ops += proc_exit(p);
+        ops += proc_fork(p);
+    }
+
+    uint64_t ns = now_ns() - start;
+
+    for (int i = 0; i < NR_PROCS; ++i)
+        proc_exit(&procs[i]);
+
+    printf("fork/exit mix: %d processes, %d exit+fork, %.1f ns/op\n",
+            NR_PROCS, rounds * 1000, (double) ns / ops);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    if (!(bench_mem = malloc(BENCH_HEAP))) {
+        fprintf(stderr, "buddybench: could not allocate boot heap\n");
+        return 1;
+    }
+
+    kernel_heap = bench_mem;
+    buddy_setup(BENCH_MEM);
+    srand(1);
+
+    printf("buddybench: %lu MiB, %d rounds\n", BENCH_MEM >> 20, rounds);
+    printf("order  blocks  alloc (ns)  free (ns)\n");
+
+    for (size_t order = 0; order <= BUDDY_MAX_ORDER; ++order)
+        bench_order(order, rounds);
+
+    bench_fork_exit(rounds);
+
+    /* Everything went back, the free lists must have coalesced fully */
+    if (buddies[BUDDY_MAX_ORDER].usable != BENCH_MEM / BUDDY_MAX_BS - 1) {
+        fprintf(stderr, "buddybench: %d blocks of order %d free, expected %d\n",
+                (int) buddies[BUDDY_MAX_ORDER].usable, BUDDY_MAX_ORDER,
+                (int) (BENCH_MEM / BUDDY_MAX_BS - 1));
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef _PANIC_H
+#define _PANIC_H
+
+#include <core/system.h>
+
+#define panic(s) \
+{\
+	fprintf(stderr, "KERNEL PANIC:\n%s [%d] %s: %s\n", \
+		__FILE__, __LINE__, __func__, s);\
+	abort(); \
+}\
+
+#endif /* !_PANIC_H */
@@ -0,0 +1,6 @@
+#ifndef _STRING_H
+#define _STRING_H
+
+#include <core/system.h>
+
+#endif /* ! _STRING_H */
@@ -0,0 +1,25 @@
+#ifndef _SYSTEM_H
+#define _SYSTEM_H
+
+/* Host stand-in for the kernel's core/system.h, see buddybench.c */
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _BV(b) (1 << (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#define MEMBER_SIZE(type, member) (sizeof(((type *)0)->member))
+
+/* The benchmark's memory starts at physical address 0 */
+extern char *bench_mem;
+#define LMA(obj)  ((uintptr_t)(void*)(obj) - (uintptr_t)(void*)bench_mem)
+
+#define printk(...)
+
+#endif /* !_SYSTEM_H */
@@ -15,109 +15,110 @@
 #include <mm/heap.h>
 
 
-#define BUDDY_MAX_ORDER (10)
-#define BUDDY_MIN_BS (4096)
-#define BUDDY_MAX_BS (BUDDY_MIN_BS << BUDDY_MAX_ORDER)
-
 struct buddy buddies[BUDDY_MAX_ORDER+1];
 
-size_t buddy_recursive_alloc(size_t order)
+/* Free list links, indexed by frame number */
+static struct buddy_link *buddy_links = NULL;
+
+static inline void buddy_push(size_t order, size_t idx)
 {
-    if (order > BUDDY_MAX_ORDER)
-        return -1;
+    struct buddy *b = &buddies[order];
+    uint32_t frame = idx << order;
 
-    /* Check if there is a free bit in current order */
-    if (buddies[order].usable) {
-        /* Search for a free bit in current order */
-        for (size_t i = buddies[order].first_free_idx; i <= buddies[order].bitmap.max_idx; ++i) {
+    buddy_links[frame].prev = BUDDY_NIL;
+    buddy_links[frame].next = b->free_list;
 
-            /* If bit at i is not checked */
-            if (!bitmap_check(&buddies[order].bitmap, i)) {
+    if (b->free_list != BUDDY_NIL)
+        buddy_links[b->free_list].prev = frame;
 
-                /* Mark the bit as used */
-                bitmap_set(&buddies[order].bitmap, i);
-                --buddies[order].usable;
+    b->free_list = frame;
+    bitmap_clear(&b->bitmap, idx);
+    ++b->usable;
+}
 
-                /* Shift first_free_idx to search after child_idx */
-                buddies[order].first_free_idx = i + 1;
+static inline void buddy_unlink(size_t order, size_t idx)
+{
+    struct buddy *b = &buddies[order];
+    uint32_t frame = idx << order;
+    struct buddy_link *link = &buddy_links[frame];
 
-                return i;
-            }                
-        }
+    if (link->prev != BUDDY_NIL)
+        buddy_links[link->prev].next = link->next;
+    else
+        b->free_list = link->next;
 
-        return -1;
-    } else {
-        /* Search for a buddy in higher order to split */
-        size_t idx = buddy_recursive_alloc(order + 1);
+    if (link->next != BUDDY_NIL)
+        buddy_links[link->next].prev = link->prev;
+
+    bitmap_set(&b->bitmap, idx);
+    --b->usable;
+}
 
-        /* Could not find a free budy */
-        if (idx == (size_t) -1) return -1;
+static size_t buddy_order(size_t size)
+{
+    size_t order = 0;
+    size_t sz = BUDDY_MIN_BS;
 
-        /* Select the left child of the selected bit */
-        size_t child_idx = idx << 1;
+    while (sz < size) {
+        sz <<= 1;
+        ++order;
+    }
 
-        /* Mark the selected bit as used */
-        bitmap_set(&buddies[order].bitmap, child_idx);
+    return order;
+}
+
+static size_t buddy_block_alloc(size_t order)
+{
+    /* Find the smallest order with a free block */
+    size_t o = order;
+    while (o <= BUDDY_MAX_ORDER && !buddies[o].usable)
+        ++o;
 
-        /* Mark it's buddy as free */
-        bitmap_clear(&buddies[order].bitmap, BUDDY_IDX(child_idx));
-        ++buddies[order].usable;
+    if (o > BUDDY_MAX_ORDER)
+        return -1;
 
-        /* Shift first_free_idx to search after child_idx */
-        buddies[order].first_free_idx = child_idx + 1;
+    size_t idx = buddies[o].free_list >> o;
+    buddy_unlink(o, idx);
 
-        return child_idx;
+    /* Split down to the requested order, right halves become free */
+    while (o > order) {
+        --o;
+        idx <<= 1;
+        buddy_push(o, BUDDY_IDX(idx));
     }
 
-    return -1;
+    return idx;
 }
 
-void buddy_recursive_free(size_t order, size_t idx)
+static void buddy_block_free(size_t order, size_t idx)
 {
-    if (order > BUDDY_MAX_ORDER) return;
     if (idx > buddies[order].bitmap.max_idx) return;
 
-    /* Can't free an already free bit */
+    /* Can't free an already free block */
     if (!bitmap_check(&buddies[order].bitmap, idx)) return;
 
-    /* Check if buddy bit is free, then combine */
-    if (order < BUDDY_MAX_ORDER && !bitmap_check(&buddies[order].bitmap, BUDDY_IDX(idx))) {
-        bitmap_set(&buddies[order].bitmap, BUDDY_IDX(idx));
-        --buddies[order].usable;
-
-        buddy_recursive_free(order + 1, idx >> 1);
-    } else {
-        bitmap_clear(&buddies[order].bitmap, idx);
-        ++buddies[order].usable;
-
-        /* Update first_free_idx */
-        if (buddies[order].first_free_idx > idx)
-            buddies[order].first_free_idx = idx;
+    /* Combine with buddy as long as it is free */
+    while (order < BUDDY_MAX_ORDER && !bitmap_check(&buddies[order].bitmap, BUDDY_IDX(idx))) {
+        buddy_unlink(order, BUDDY_IDX(idx));
+        idx >>= 1;
+        ++order;
     }
+
+    buddy_push(order, idx);
 }
 
 uintptr_t buddy_alloc(size_t _sz)
 {
     if (_sz > BUDDY_MAX_BS)
-        panic("Cannot allocate buddy");
-
-    size_t sz = BUDDY_MIN_BS;
+        return (uintptr_t) NULL;
 
-    /* FIXME */
-    size_t order = 0;
-    for (; order <= BUDDY_MAX_ORDER; ++order) {
-        if (sz >= _sz)
-            break;
-        sz <<= 1;
-    }
+    size_t order = buddy_order(_sz);
+    size_t idx = buddy_block_alloc(order);
 
-    size_t idx = buddy_recursive_alloc(order);
+    if (idx == (size_t) -1)
+        return (uintptr_t) NULL;
 
-    if (idx != (size_t) -1)
-        return (uintptr_t) (idx * (BUDDY_MIN_BS << order));
-    else
-        panic("Cannot find free buddy");
-        //return (uintptr_t) NULL;
+    return (uintptr_t) (idx * (BUDDY_MIN_BS << order));
 }
 
 static uintptr_t kernel_bound = 0;
@@ -128,48 +129,47 @@ void buddy_free(uintptr_t addr, size_t size)
     if (addr < kernel_bound)
         panic("Trying to free from kernel code");
 
-    size_t sz = BUDDY_MIN_BS;
+    if (size > BUDDY_MAX_BS)
+        panic("Trying to free oversized buddy");
 
-    /* FIXME */
-    size_t order = 0;
-    for (; order < BUDDY_MAX_ORDER; ++order) {
-        if (sz >= size)
-            break;
-        sz <<= 1;
-    }
+    size_t order = buddy_order(size);
+
+    if (addr & ((BUDDY_MIN_BS << order) - 1))
+        panic("Trying to free unaligned buddy");
 
-    size_t idx = (addr / (BUDDY_MIN_BS << order)) & (sz - 1);
+    size_t idx = addr / (BUDDY_MIN_BS << order);
 
     //printk("order = %d, idx = %d\n", order, idx);
 
-    buddy_recursive_free(order, idx);
+    buddy_block_free(order, idx);
 }
 
 void buddy_dump()
 {
     for (size_t i = 0; i <= BUDDY_MAX_ORDER; ++i) {
-        size_t blocks = bitmap_size(buddies[i].bitmap.max_idx + 1)/MEMBER_SIZE(bitmap_t, map[0]);
-        printk("Order %d: [%d blocks][%d free bit(s)]\n", i, blocks, buddies[i].usable);
-        for (size_t j = 0; j < blocks; ++j) {
-            printk("map[%d] = %x\n", j, buddies[i].bitmap.map[j]);
-        }
-        printk("\n");
+        printk("Order %d: [%d blocks][%d free block(s)][head %x]\n", i,
+                buddies[i].bitmap.max_idx + 1, buddies[i].usable,
+                buddies[i].free_list == BUDDY_NIL ? 0 : buddies[i].free_list * BUDDY_MIN_BS);
     }
 }
 
 void buddy_set_unusable(uintptr_t addr, size_t size)
 {
+    size_t max_idx   = buddies[BUDDY_MAX_ORDER].bitmap.max_idx;
     size_t start_idx = addr / BUDDY_MAX_BS;
     size_t end_idx   = (addr + size + BUDDY_MAX_BS - 1) / BUDDY_MAX_BS;
 
-    bitmap_set_range(&buddies[BUDDY_MAX_ORDER].bitmap, start_idx, end_idx);
+    if (start_idx > max_idx || end_idx <= start_idx)
+        return;
 
-    size_t ffidx = buddies[BUDDY_MAX_ORDER].first_free_idx;
+    if (end_idx > max_idx + 1)
+        end_idx = max_idx + 1;
 
-    if (ffidx >= start_idx && ffidx <= end_idx)
-        buddies[BUDDY_MAX_ORDER].first_free_idx = end_idx + 1;
-
-    buddies[BUDDY_MAX_ORDER].usable -= (end_idx - start_idx + 1);
+    /* Only blocks that are still free as a whole can be taken out */
+    for (size_t i = start_idx; i < end_idx; ++i) {
+        if (!bitmap_check(&buddies[BUDDY_MAX_ORDER].bitmap, i))
+            buddy_unlink(BUDDY_MAX_ORDER, i);
+    }
 }
 
 void buddy_setup(size_t total_mem)
@@ -190,14 +190,15 @@ void buddy_setup(size_t total_mem)
         bits_cnt <<= 1;
     }
 
-    /* Set the heighst order as free and the rest as unusable */
-    bitmap_clear_range(&buddies[BUDDY_MAX_ORDER].bitmap, 0, buddies[BUDDY_MAX_ORDER].bitmap.max_idx);
-    buddies[BUDDY_MAX_ORDER].first_free_idx = 0;
-    buddies[BUDDY_MAX_ORDER].usable = buddies[BUDDY_MAX_ORDER].bitmap.max_idx + 1;
+    /* bits_cnt is now twice the number of frames */
+    size_t links_size = (bits_cnt >> 1) * sizeof(struct buddy_link);
+    buddy_links = heap_alloc(links_size, 4);
+    total_size += links_size;
 
-    for (int i = 0; i < BUDDY_MAX_ORDER; ++i) {
+    /* Mark all blocks as used, pushing to free lists clears the bits */
+    for (int i = 0; i <= BUDDY_MAX_ORDER; ++i) {
         bitmap_set_range(&buddies[i].bitmap, 0, buddies[i].bitmap.max_idx);
-        buddies[i].first_free_idx = -1;
+        buddies[i].free_list = BUDDY_NIL;
         buddies[i].usable = 0;
     }
 
@@ -205,7 +206,8 @@ void buddy_setup(size_t total_mem)
     size_t kernel_buddies = ((uintptr_t) LMA(kernel_heap) + BUDDY_MAX_BS - 1)/BUDDY_MAX_BS;
     kernel_bound = kernel_buddies * BUDDY_MAX_BS;
 
-    for (size_t i = 0; i < kernel_buddies; ++i) {
-        buddy_alloc(BUDDY_MAX_BS);
+    /* Push in reverse so that lower addresses are handed out first */
+    for (size_t i = buddies[BUDDY_MAX_ORDER].bitmap.max_idx + 1; i > kernel_buddies; --i) {
+        buddy_push(BUDDY_MAX_ORDER, i - 1);
     }
 }
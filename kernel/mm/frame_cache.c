@@ -0,0 +1,137 @@
+/**********************************************************************
+ *                  Per-CPU Page Frame Cache
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/panic.h>
+#include <mm/mm.h>
+#include <mm/frame_cache.h>
+
+#define FRAME_CACHE_MASK (FRAME_CACHE_HIGH - 1)
+
+struct frame_cache frame_caches[FRAME_CACHE_CPUS];
+
+static inline struct frame_cache *this_frame_cache()
+{
+    /* FIXME: Use the current CPU id once SMP is up */
+    return &frame_caches[0];
+}
+
+static inline uintptr_t frame_cache_pop_front(struct frame_cache *fc)
+{
+    uintptr_t frame = fc->frames[fc->head];
+    fc->head = (fc->head + 1) & FRAME_CACHE_MASK;
+    --fc->count;
+    return frame;
+}
+
+static inline uintptr_t frame_cache_pop_back(struct frame_cache *fc)
+{
+    --fc->count;
+    return fc->frames[(fc->head + fc->count) & FRAME_CACHE_MASK];
+}
+
+static inline void frame_cache_push_front(struct frame_cache *fc, uintptr_t frame)
+{
+    fc->head = (fc->head - 1) & FRAME_CACHE_MASK;
+    fc->frames[fc->head] = frame;
+    ++fc->count;
+}
+
+static inline void frame_cache_push_back(struct frame_cache *fc, uintptr_t frame)
+{
+    fc->frames[(fc->head + fc->count) & FRAME_CACHE_MASK] = frame;
+    ++fc->count;
+}
+
+static void frame_cache_refill(struct frame_cache *fc)
+{
+    ++fc->refills;
+
+    /* Try to grab the whole batch as a single buddy and split it */
+    uintptr_t block = buddy_alloc(FRAME_CACHE_BATCH * PAGE_SIZE);
+
+    if (block) {
+        for (size_t i = 0; i < FRAME_CACHE_BATCH; ++i)
+            frame_cache_push_back(fc, block + i * PAGE_SIZE);
+        return;
+    }
+
+    /* Memory is fragmented, fall back to single frames */
+    for (size_t i = 0; i < FRAME_CACHE_BATCH; ++i) {
+        uintptr_t frame = buddy_alloc(PAGE_SIZE);
+
+        if (!frame)
+            break;
+
+        frame_cache_push_back(fc, frame);
+    }
+}
+
+static void frame_cache_drain(struct frame_cache *fc, size_t nr)
+{
+    ++fc->drains;
+
+    while (nr-- && fc->count)
+        buddy_free(frame_cache_pop_back(fc), PAGE_SIZE);
+}
+
+uintptr_t frame_cache_alloc()
+{
+    struct frame_cache *fc = this_frame_cache();
+
+    if (fc->count) {
+        ++fc->hits;
+    } else {
+        ++fc->misses;
+        frame_cache_refill(fc);
+
+        if (!fc->count)
+            return (uintptr_t) NULL;
+    }
+
+    return frame_cache_pop_front(fc);
+}
+
+void frame_cache_free(uintptr_t frame, int cold)
+{
+    struct frame_cache *fc = this_frame_cache();
+
+    if (frame & PAGE_MASK)
+        panic("Trying to free unaligned frame");
+
+    if (fc->count == FRAME_CACHE_HIGH)
+        frame_cache_drain(fc, FRAME_CACHE_BATCH);
+
+    if (cold)
+        frame_cache_push_back(fc, frame);
+    else
+        frame_cache_push_front(fc, frame);
+}
+
+void frame_cache_drain_all()
+{
+    for (int i = 0; i < FRAME_CACHE_CPUS; ++i) {
+        if (frame_caches[i].count)
+            frame_cache_drain(&frame_caches[i], frame_caches[i].count);
+    }
+}
+
+void frame_cache_dump()
+{
+    for (int i = 0; i < FRAME_CACHE_CPUS; ++i) {
+        struct frame_cache *fc = &frame_caches[i];
+
+        if (!fc->hits && !fc->misses)
+            continue;
+
+        printk("CPU %d: [%d frames][%d hits][%d misses][%d refills][%d drains]\n",
+                i, fc->count, fc->hits, fc->misses, fc->refills, fc->drains);
+    }
+}
@@ -0,0 +1,45 @@
+/**********************************************************************
+ *                  Memory Accounting
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/string.h>
+#include <core/arch.h>
+#include <mm/mm.h>
+#include <mm/meminfo.h>
+#include <mm/frame_cache.h>
+#include <mm/slab.h>
+#include <mm/vmalloc.h>
+#include <mm/page_cache.h>
+
+void meminfo_get(struct meminfo *info)
+{
+    memset(info, 0, sizeof(struct meminfo));
+
+    info->total = buddies[0].bitmap.max_idx + 1;
+
+    for (size_t i = 0; i <= BUDDY_MAX_ORDER; ++i) {
+        info->free_blocks[i] = buddies[i].usable;
+        info->free += buddies[i].usable << i;
+    }
+
+    for (size_t i = 0; i < FRAME_CACHE_CPUS; ++i)
+        info->cached += frame_caches[i].count;
+
+    for (struct kmem_cache *cache = kmem_caches; cache; cache = cache->next)
+        info->slab += KMEM_CACHE_BYTES(cache);
+
+    info->vmalloc = vmalloc_used;
+    info->page_cache = page_cache_pages;
+
+    /* Zero pool, page tables and shared pages are kept by the arch */
+    arch_meminfo(info);
+
+    info->used = info->total - info->free - info->cached - info->zeroed;
+}
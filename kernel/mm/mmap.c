@@ -0,0 +1,274 @@
+/**********************************************************************
+ *                  Memory Mappings
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/arch.h>
+#include <mm/mm.h>
+#include <mm/slab.h>
+#include <mm/vma.h>
+#include <sys/proc.h>
+#include <sys/sched.h>
+#include <fs/vfs.h>
+
+#include <bits/errno.h>
+#include <bits/fcntl.h>
+#include <bits/mman.h>
+
+/*
+ *  mmap only creates areas, pages are filled in by the page fault handler
+ *  the first time they are touched (see handle_page_fault). Devices are
+ *  the exception, their driver maps the whole area through dev->mmap.
+ */
+
+static inline int prot_to_flags(int prot)
+{
+    return (prot & PROT_READ  ? UR : 0) |
+           (prot & PROT_WRITE ? UW : 0) |
+           (prot & PROT_EXEC  ? UX : 0);
+}
+
+/* Split `vma' in two at `addr', the upper half follows it in the list */
+static int vma_split(struct vma *vma, uintptr_t addr)
+{
+    struct vma *upper = kmem_cache_alloc(&vma_cache);
+
+    if (!upper)
+        return -ENOMEM;
+
+    *upper = *vma;
+    upper->start = addr;
+
+    if (vma->type == VMA_FILE) {
+        size_t lower = addr - vma->start;
+        upper->off   += lower;
+        upper->filesz = vma->filesz > lower ? vma->filesz - lower : 0;
+        vma->filesz   = MIN(vma->filesz, lower);
+    }
+
+    /* sbrk keeps moving the end of the heap, only the upper half is the heap */
+    vma->flags &= ~VMA_HEAP;
+    vma->end  = addr;
+    vma->next = upper;
+
+    return 0;
+}
+
+static int vma_range_free(struct vma *list, uintptr_t start, uintptr_t end)
+{
+    forlinked (vma, list, vma->next) {
+        if (vma->start >= end)
+            break;
+
+        if (vma->end > start || vma->start == start)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Find a free range for a new mapping, searching top-down from the stack */
+static uintptr_t vma_unmapped_area(struct vma *list, size_t len)
+{
+    uintptr_t prev_end = PAGE_SIZE, found = 0;
+
+    forlinked (vma, list, vma->next) {
+        if (vma->start >= prev_end && vma->start - prev_end >= len)
+            found = vma->start - len;
+
+        prev_end = vma->end;
+    }
+
+    if (USER_STACK >= prev_end && USER_STACK - prev_end >= len)
+        found = USER_STACK - len;
+
+    return found;
+}
+
+uintptr_t vma_mmap(uintptr_t addr, size_t len, int prot, int flags, int fildes, off_t off)
+{
+    int shared = flags & MAP_SHARED;
+    int type = VMA_ANON;
+    struct fs_node *node = NULL;
+
+    if (!len || len > USER_STACK || (off & PAGE_MASK) || off < 0)
+        return -EINVAL;
+
+    if (!(flags & (MAP_SHARED | MAP_PRIVATE)) || (shared && (flags & MAP_PRIVATE)))
+        return -EINVAL;
+
+    len = PAGE_ROUND_UP(len);
+
+    if (!(flags & MAP_ANONYMOUS)) {
+        if (fildes < 0 || fildes >= FDS_COUNT || !(node = cur_proc->fds[fildes].node))
+            return -EBADFD;
+
+        if ((cur_proc->fds[fildes].flags & O_WRONLY))
+            return -EACCES;
+
+        if (node->dev && node->dev->mmap) {
+            /* Device memory is the same for everyone, private makes no sense */
+            type = VMA_DEVICE;
+            shared = 1;
+        } else if (node->type == FS_FILE) {
+            type = VMA_FILE;
+        } else {
+            return -ENODEV;
+        }
+
+        /* No page cache to write back to yet, writes would be lost */
+        if (type == VMA_FILE && shared && (prot & PROT_WRITE))
+            return -ENOTSUP;
+    } else if (shared) {
+        /* No object to share the pages through, pages faulted in after a
+         * fork would silently stop being shared */
+        return -ENOTSUP;
+    }
+
+    if (flags & MAP_FIXED) {
+        if ((addr & PAGE_MASK) || addr < PAGE_SIZE || addr > USER_STACK - len)
+            return -EINVAL;
+
+        int err = vma_munmap(addr, len);
+
+        if (err)
+            return err;
+    } else if ((addr & PAGE_MASK) || addr < PAGE_SIZE || addr > USER_STACK - len
+            || !vma_range_free(cur_proc->vmas, addr, addr + len)) {
+        /* Hint not usable */
+        if (!(addr = vma_unmapped_area(cur_proc->vmas, len)))
+            return -ENOMEM;
+    }
+
+    struct vma *vma = vma_insert(&cur_proc->vmas, addr, addr + len, prot_to_flags(prot),
+            shared ? VMA_SHARED : 0, type);
+
+    if (!vma)
+        return -ENOMEM;
+
+    vma->node   = node;
+    vma->off    = off;
+    vma->filesz = len;
+
+    /* Devices map everything up front, there is nothing to fault in */
+    if (type == VMA_DEVICE) {
+        int err = node->dev->mmap(node, vma);
+
+        if (err) {
+            vma_munmap(addr, len);
+            return err;
+        }
+    }
+
+    return addr;
+}
+
+int vma_munmap(uintptr_t addr, size_t len)
+{
+    if ((addr & PAGE_MASK) || !len || len > USER_STACK || addr > USER_STACK - len)
+        return -EINVAL;
+
+    uintptr_t start = addr, end = PAGE_ROUND_UP(addr + len);
+    struct vma **link = &cur_proc->vmas;
+    int err = 0;
+
+    arch_tlb_batch_begin();
+
+    while (*link) {
+        struct vma *vma = *link;
+
+        if (vma->start >= end)
+            break;
+
+        if (vma->end <= start) {
+            link = &vma->next;
+            continue;
+        }
+
+        if (vma->start < start) {
+            if ((err = vma_split(vma, start)))
+                break;
+
+            link = &vma->next;
+            continue;
+        }
+
+        if (vma->end > end && (err = vma_split(vma, end)))
+            break;
+
+        /* `vma' now lies completely inside the range */
+        if (vma->end > vma->start)
+            pmman.unmap(vma->start, vma->end - vma->start);
+
+        *link = vma->next;
+        kmem_cache_free(&vma_cache, vma);
+    }
+
+    arch_tlb_batch_end();
+
+    return err;
+}
+
+int vma_mprotect(uintptr_t addr, size_t len, int prot)
+{
+    if ((addr & PAGE_MASK) || !len || len > USER_STACK || addr > USER_STACK - len)
+        return -EINVAL;
+
+    uintptr_t start = addr, end = PAGE_ROUND_UP(addr + len);
+    uintptr_t next = start;
+
+    /* The whole range must be mapped */
+    forlinked (vma, cur_proc->vmas, vma->next) {
+        if (vma->end <= next)
+            continue;
+
+        if (vma->start > next)
+            break;
+
+        if ((vma->flags & VMA_SHARED) && vma->type == VMA_FILE && (prot & PROT_WRITE))
+            return -EACCES;
+
+        next = vma->end;
+
+        if (next >= end)
+            break;
+    }
+
+    if (next < end)
+        return -ENOMEM;
+
+    int flags = prot_to_flags(prot), err = 0;
+
+    arch_tlb_batch_begin();
+
+    forlinked (vma, cur_proc->vmas, vma->next) {
+        if (vma->start >= end)
+            break;
+
+        if (vma->end <= start)
+            continue;
+
+        if (vma->start < start) {
+            if ((err = vma_split(vma, start)))
+                break;
+
+            continue;   /* Next iteration handles the upper half */
+        }
+
+        if (vma->end > end && (err = vma_split(vma, end)))
+            break;
+
+        vma->prot = flags;
+        pmman.protect(vma->start, vma->end - vma->start, flags);
+    }
+
+    arch_tlb_batch_end();
+
+    return err;
+}
@@ -0,0 +1,112 @@
+/**********************************************************************
+ *                  Page Cache
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/string.h>
+#include <mm/mm.h>
+#include <mm/slab.h>
+#include <mm/page_cache.h>
+#include <fs/vfs.h>
+
+static struct kmem_cache cached_page_cache = KMEM_CACHE_INIT("cached_page", sizeof(struct cached_page), 0, NULL);
+static struct cached_page *page_cache[PAGE_CACHE_BUCKETS];
+
+size_t page_cache_pages = 0;
+
+static inline size_t page_cache_hash(struct fs *fs, size_t inode, off_t off)
+{
+    return ((uintptr_t) fs / sizeof(void *) + inode * 31 + off / PAGE_SIZE) % PAGE_CACHE_BUCKETS;
+}
+
+/*
+ * Returns the frame holding the page of `node' at `off', reading it in on
+ * a miss. Only regular files with an inode number are cached, 0 is
+ * returned for anything else (and on failure) and the caller has to read
+ * the data itself.
+ */
+uintptr_t page_cache_get(struct fs_node *node, off_t off)
+{
+    if (node->type != FS_FILE || !node->inode || (off & PAGE_MASK))
+        return 0;
+
+    size_t bucket = page_cache_hash(node->fs, node->inode, off);
+
+    forlinked (page, page_cache[bucket], page->next) {
+        if (page->fs == node->fs && page->inode == node->inode && page->off == off)
+            return page->frame;
+    }
+
+    struct cached_page *page = kmem_cache_alloc(&cached_page_cache);
+
+    if (!page)
+        return 0;
+
+    uintptr_t frame = arch_get_frame_no_clr();
+    size_t size = off < (off_t) node->size ? MIN(PAGE_SIZE, node->size - off) : 0;
+
+    char *data = arch_kmap(frame);
+    ssize_t ret = size ? vfs.read(node, off, size, data) : 0;
+
+    if (ret >= 0)
+        memset(data + ret, 0, PAGE_SIZE - ret);
+
+    arch_kunmap(data);
+
+    if (ret < 0) {
+        arch_release_frame(frame);
+        kmem_cache_free(&cached_page_cache, page);
+        return 0;
+    }
+
+    arch_page_ref(frame);
+
+    page->fs    = node->fs;
+    page->inode = node->inode;
+    page->off   = off;
+    page->frame = frame;
+    page->next  = page_cache[bucket];
+    page_cache[bucket] = page;
+
+    ++page_cache_pages;
+
+    return frame;
+}
+
+/*
+ * Drop cached pages of `node' overlapping [off, off + size), called when
+ * the file is written. Pages still mapped keep their old contents until
+ * unmapped, like a private mapping would.
+ */
+void page_cache_invalidate(struct fs_node *node, off_t off, size_t size)
+{
+    if (!page_cache_pages || !node->inode || !size)
+        return;
+
+    off_t start = off & ~PAGE_MASK;
+
+    for (off_t cur = start; cur < off + (off_t) size; cur += PAGE_SIZE) {
+        size_t bucket = page_cache_hash(node->fs, node->inode, cur);
+        struct cached_page **link = &page_cache[bucket];
+
+        while (*link) {
+            struct cached_page *page = *link;
+
+            if (page->fs == node->fs && page->inode == node->inode && page->off == cur) {
+                *link = page->next;
+                arch_page_unref(page->frame);
+                kmem_cache_free(&cached_page_cache, page);
+                --page_cache_pages;
+                break;
+            }
+
+            link = &page->next;
+        }
+    }
+}
@@ -0,0 +1,327 @@
+/**********************************************************************
+ *                  Slab Allocator
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/string.h>
+#include <core/panic.h>
+#include <mm/mm.h>
+#include <mm/slab.h>
+#include <ds/queue.h>
+
+/*
+ *  The slab area is split into one region per slab order, so the order
+ *  (and so the slab descriptor) of any object is known from its address.
+ */
+
+#define SLAB_REGION_SIZE    (SLAB_SIZE / (SLAB_MAX_ORDER + 1))
+#define SLAB_BYTES(order)   (PAGE_SIZE << (order))
+#define SLAB_CHUNKS(order)  (SLAB_REGION_SIZE / SLAB_BYTES(order))
+
+#define ALIGN_UP(x, a)      (((x) + (a) - 1) & ~((a) - 1))
+
+static struct slab_region {
+    uintptr_t base;
+    uintptr_t next;     /* Next never used chunk */
+    size_t nr_free;
+    uint16_t *free;     /* Stack of released chunks indices */
+} slab_regions[SLAB_MAX_ORDER + 1];
+
+static uint16_t slab_chunks_stack[2 * SLAB_CHUNKS(0)];
+
+static void *slab_chunk_alloc(size_t order)
+{
+    struct slab_region *r = &slab_regions[order];
+    uintptr_t chunk;
+
+    if (r->nr_free) {
+        chunk = r->base + r->free[--r->nr_free] * SLAB_BYTES(order);
+    } else if (r->next < r->base + SLAB_REGION_SIZE) {
+        chunk = r->next;
+        r->next += SLAB_BYTES(order);
+    } else {
+        return NULL;
+    }
+
+    pmman.map(chunk, SLAB_BYTES(order), KRW);
+    return (void *) chunk;
+}
+
+static void slab_chunk_free(size_t order, void *chunk)
+{
+    struct slab_region *r = &slab_regions[order];
+
+    pmman.unmap((uintptr_t) chunk, SLAB_BYTES(order));
+    r->free[r->nr_free++] = ((uintptr_t) chunk - r->base) / SLAB_BYTES(order);
+}
+
+static inline struct slab *slab_of(void *obj)
+{
+    uintptr_t addr = (uintptr_t) obj;
+    size_t order = (addr - SLAB_BASE) / SLAB_REGION_SIZE;
+    return (struct slab *) (addr & ~(SLAB_BYTES(order) - 1));
+}
+
+/* ================== Slab Lists ================== */
+
+static inline void slab_list_add(struct slab **list, struct slab *slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+
+    if (*list)
+        (*list)->prev = slab;
+
+    *list = slab;
+}
+
+static inline void slab_list_remove(struct slab **list, struct slab *slab)
+{
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        *list = slab->next;
+
+    if (slab->next)
+        slab->next->prev = slab->prev;
+
+    slab->prev = slab->next = NULL;
+}
+
+/* ================== Slabs ================== */
+
+static inline size_t slab_header_size(struct kmem_cache *cache, size_t objs)
+{
+    return ALIGN_UP(sizeof(struct slab) + objs * sizeof(uint16_t), cache->align);
+}
+
+struct kmem_cache *kmem_caches = NULL;
+
+static void kmem_cache_setup(struct kmem_cache *cache)
+{
+    if (!cache->align)
+        cache->align = sizeof(void *);
+
+    if (cache->align & (cache->align - 1))
+        panic("Slab alignment must be a power of two");
+
+    cache->size = ALIGN_UP(MAX(cache->size, 1), cache->align);
+
+    /* Choose the smallest slab that holds at least 8 objects */
+    for (cache->order = 0; cache->order <= SLAB_MAX_ORDER; ++cache->order) {
+        size_t bytes = SLAB_BYTES(cache->order);
+        size_t objs  = (bytes - sizeof(struct slab)) / (cache->size + sizeof(uint16_t));
+
+        while (objs && slab_header_size(cache, objs) + objs * cache->size > bytes)
+            --objs;
+
+        cache->objs = MIN(objs, SLAB_BUFCTL_END);
+
+        if (cache->objs >= 8)
+            break;
+    }
+
+    if (cache->order > SLAB_MAX_ORDER)
+        cache->order = SLAB_MAX_ORDER;
+
+    if (!cache->objs)
+        panic("Slab object is too large");
+
+    cache->next = kmem_caches;
+    kmem_caches = cache;
+}
+
+static struct slab *slab_new(struct kmem_cache *cache)
+{
+    struct slab *slab = slab_chunk_alloc(cache->order);
+
+    if (!slab)
+        return NULL;
+
+    slab->cache = cache;
+    slab->prev  = slab->next = NULL;
+    slab->mem   = (char *) slab + slab_header_size(cache, cache->objs);
+    slab->inuse = 0;
+    slab->free  = 0;
+
+    for (size_t i = 0; i < cache->objs - 1; ++i)
+        slab->bufctl[i] = i + 1;
+
+    slab->bufctl[cache->objs - 1] = SLAB_BUFCTL_END;
+
+    if (cache->ctor) {
+        for (size_t i = 0; i < cache->objs; ++i)
+            cache->ctor(slab->mem + i * cache->size);
+    }
+
+    ++cache->nr_slabs;
+
+    return slab;
+}
+
+static void slab_destroy(struct slab *slab)
+{
+    --slab->cache->nr_slabs;
+    slab_chunk_free(slab->cache->order, slab);
+}
+
+/* ================== Caches ================== */
+
+static struct kmem_cache cache_cache = KMEM_CACHE_INIT("kmem_cache", sizeof(struct kmem_cache), 0, NULL);
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align, void (*ctor)(void *))
+{
+    struct kmem_cache *cache = kmem_cache_alloc(&cache_cache);
+
+    if (!cache)
+        return NULL;
+
+    memset(cache, 0, sizeof(struct kmem_cache));
+    cache->name  = name;
+    cache->size  = size;
+    cache->align = align;
+    cache->ctor  = ctor;
+
+    return cache;
+}
+
+void *kmem_cache_alloc(struct kmem_cache *cache)
+{
+    if (!cache->objs)
+        kmem_cache_setup(cache);
+
+    struct slab *slab = cache->partial;
+
+    if (!slab) {
+        if ((slab = cache->empty)) {
+            slab_list_remove(&cache->empty, slab);
+            --cache->nr_empty;
+        } else if (!(slab = slab_new(cache))) {
+            return NULL;
+        }
+
+        slab_list_add(&cache->partial, slab);
+    }
+
+    size_t idx = slab->free;
+    slab->free = slab->bufctl[idx];
+    ++slab->inuse;
+
+    ++cache->active;
+    ++cache->allocs;
+
+    if (slab->inuse == cache->objs) {
+        slab_list_remove(&cache->partial, slab);
+        slab_list_add(&cache->full, slab);
+    }
+
+    return slab->mem + idx * cache->size;
+}
+
+void kmem_cache_free(struct kmem_cache *cache, void *obj)
+{
+    struct slab *slab = slab_of(obj);
+
+    if (slab->cache != cache)
+        panic("Object freed to the wrong cache");
+
+    size_t off = (char *) obj - slab->mem;
+
+    if (off % cache->size || off / cache->size >= cache->objs)
+        panic("Trying to free invalid object");
+
+    size_t idx = off / cache->size;
+    struct slab **list = slab->inuse == cache->objs ? &cache->full : &cache->partial;
+
+    slab->bufctl[idx] = slab->free;
+    slab->free = idx;
+    --slab->inuse;
+
+    --cache->active;
+    ++cache->frees;
+
+    if (!slab->inuse) {
+        slab_list_remove(list, slab);
+
+        if (cache->nr_empty < SLAB_EMPTY_MAX) {
+            slab_list_add(&cache->empty, slab);
+            ++cache->nr_empty;
+        } else {
+            slab_destroy(slab);
+        }
+    } else if (list == &cache->full) {
+        slab_list_remove(&cache->full, slab);
+        slab_list_add(&cache->partial, slab);
+    }
+}
+
+/* ================== General Purpose Caches ================== */
+
+static struct kmem_cache kmalloc_caches[] = {
+    KMEM_CACHE_INIT("kmalloc-16",   16,   0, NULL),
+    KMEM_CACHE_INIT("kmalloc-32",   32,   0, NULL),
+    KMEM_CACHE_INIT("kmalloc-64",   64,   0, NULL),
+    KMEM_CACHE_INIT("kmalloc-128",  128,  0, NULL),
+    KMEM_CACHE_INIT("kmalloc-256",  256,  0, NULL),
+    KMEM_CACHE_INIT("kmalloc-512",  512,  0, NULL),
+    KMEM_CACHE_INIT("kmalloc-1024", 1024, 0, NULL),
+    KMEM_CACHE_INIT("kmalloc-2048", 2048, 0, NULL),
+};
+
+void *kmem_alloc(size_t size)
+{
+    if (size > KMALLOC_MAX_SIZE)
+        return NULL;
+
+    size_t idx = 0;
+    while ((size_t) (KMALLOC_MIN_SIZE << idx) < size)
+        ++idx;
+
+    return kmem_cache_alloc(&kmalloc_caches[idx]);
+}
+
+void kmem_free(void *obj)
+{
+    struct slab *slab = slab_of(obj);
+    kmem_cache_free(slab->cache, obj);
+}
+
+/* ================== Common Object Caches ================== */
+
+static void queue_ctor(void *obj)
+{
+    memset(obj, 0, sizeof(queue_t));
+}
+
+struct kmem_cache queue_node_cache = KMEM_CACHE_INIT("queue_node", sizeof(struct queue_node), 0, NULL);
+struct kmem_cache queue_cache = KMEM_CACHE_INIT("queue", sizeof(queue_t), 0, queue_ctor);
+
+void kmem_cache_dump()
+{
+    for (struct kmem_cache *cache = kmem_caches; cache; cache = cache->next) {
+        printk("%s: [%d/%d objects][%d B][%d slabs][%d allocs][%d frees]\n",
+                cache->name, cache->active, cache->nr_slabs * cache->objs,
+                cache->size, cache->nr_slabs, cache->allocs, cache->frees);
+    }
+}
+
+void slab_setup()
+{
+    printk("[0] Kernel: VMM -> Setting up Slab Allocator\n");
+
+    uint16_t *stack = slab_chunks_stack;
+
+    for (size_t order = 0; order <= SLAB_MAX_ORDER; ++order) {
+        struct slab_region *r = &slab_regions[order];
+        r->base = r->next = SLAB_BASE + order * SLAB_REGION_SIZE;
+        r->nr_free = 0;
+        r->free = stack;
+        stack += SLAB_CHUNKS(order);
+    }
+}
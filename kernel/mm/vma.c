@@ -0,0 +1,155 @@
+/**********************************************************************
+ *                  Virtual Memory Areas
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/string.h>
+#include <mm/mm.h>
+#include <mm/slab.h>
+#include <mm/vma.h>
+#include <sys/proc.h>
+
+#include <bits/errno.h>
+
+struct kmem_cache vma_cache = KMEM_CACHE_INIT("vma", sizeof(struct vma), 0, NULL);
+
+/* Find the area containing `addr' */
+struct vma *vma_find(struct vma *list, uintptr_t addr)
+{
+    forlinked (vma, list, vma->next) {
+        if (addr < vma->start)
+            return NULL;
+
+        if (addr < vma->end)
+            return vma;
+    }
+
+    return NULL;
+}
+
+struct vma *vma_find_flags(struct vma *list, int flags)
+{
+    forlinked (vma, list, vma->next) {
+        if ((vma->flags & flags) == flags)
+            return vma;
+    }
+
+    return NULL;
+}
+
+/* Insert a new area, fails if it overlaps an existing one */
+struct vma *vma_insert(struct vma **list, uintptr_t start, uintptr_t end, int prot, int flags, int type)
+{
+    if ((start & PAGE_MASK) || (end & PAGE_MASK) || end < start)
+        return NULL;
+
+    struct vma **link = list, *prev = NULL;
+
+    while (*link && (*link)->start < start) {
+        prev = *link;
+        link = &(*link)->next;
+    }
+
+    if (prev && prev->end > start)
+        return NULL;
+
+    /* Empty areas (the heap before the first sbrk) still claim their start */
+    if (*link && ((*link)->start < end || (*link)->start == start))
+        return NULL;
+
+    struct vma *vma = kmem_cache_alloc(&vma_cache);
+
+    if (!vma)
+        return NULL;
+
+    memset(vma, 0, sizeof(struct vma));
+    vma->start = start;
+    vma->end   = end;
+    vma->prot  = prot;
+    vma->flags = flags;
+    vma->type  = type;
+    vma->next  = *link;
+    *link = vma;
+
+    return vma;
+}
+
+/* Copy an area list, used by fork */
+int vma_dup(struct vma **dst, struct vma *src)
+{
+    struct vma **link = dst;
+    *dst = NULL;
+
+    forlinked (vma, src, vma->next) {
+        struct vma *copy = kmem_cache_alloc(&vma_cache);
+
+        if (!copy) {
+            vma_free_all(dst);
+            return -ENOMEM;
+        }
+
+        memcpy(copy, vma, sizeof(struct vma));
+        copy->next = NULL;
+        *link = copy;
+        link = &copy->next;
+    }
+
+    return 0;
+}
+
+/* Move the end of the heap to `brk', pages above it are released */
+int vma_brk(struct vma *list, uintptr_t brk)
+{
+    struct vma *heap = vma_find_flags(list, VMA_HEAP);
+
+    if (!heap)
+        return -ENOMEM;
+
+    uintptr_t end = PAGE_ROUND_UP(brk);
+
+    if (end < heap->start)
+        return -EINVAL;
+
+    if (heap->next && end > heap->next->start)
+        return -ENOMEM;
+
+    if (end < heap->end)
+        pmman.unmap(end, heap->end - end);
+
+    heap->end = end;
+
+    return 0;
+}
+
+/*
+ * Unmap all areas of the current address space and free the list. All of
+ * user space goes in one call so whole page tables are dropped instead of
+ * walked, which is what makes exec right after fork cheap.
+ */
+void vma_unmap_all(struct vma **list)
+{
+    arch_tlb_batch_begin();
+    pmman.unmap(0, USER_STACK);
+    arch_tlb_batch_end();
+
+    vma_free_all(list);
+}
+
+void vma_free_all(struct vma **list)
+{
+    struct vma *vma = *list;
+
+    while (vma) {
+        struct vma *next = vma->next;
+        kmem_cache_free(&vma_cache, vma);
+        vma = next;
+    }
+
+    *list = NULL;
+}
@@ -0,0 +1,124 @@
+/**********************************************************************
+ *                  Large Objects Allocator
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <core/panic.h>
+#include <mm/mm.h>
+#include <mm/slab.h>
+#include <mm/vmalloc.h>
+
+static struct kmem_cache vm_area_cache = KMEM_CACHE_INIT("vm_area", sizeof(struct vm_area), 0, NULL);
+
+/* Areas sorted by address */
+static struct vm_area *vm_areas = NULL;
+
+/* Bytes handed out, excluding guard pages */
+size_t vmalloc_used = 0;
+
+static struct vm_area *vm_area_find(uintptr_t addr)
+{
+    for (struct vm_area *area = vm_areas; area; area = area->next) {
+        if (addr < area->addr)
+            break;
+
+        if (addr < area->addr + area->size)
+            return area;
+    }
+
+    return NULL;
+}
+
+void *vmalloc(size_t size, int flags)
+{
+    if (!size)
+        return NULL;
+
+    size = ((size + PAGE_MASK) & ~PAGE_MASK) + PAGE_SIZE;   /* Guard page */
+
+    /* First fit */
+    struct vm_area **link = &vm_areas;
+    uintptr_t addr = VMALLOC_BASE;
+
+    while (*link) {
+        if ((*link)->addr - addr >= size)
+            break;
+
+        addr = (*link)->addr + (*link)->size;
+        link = &(*link)->next;
+    }
+
+    if (addr + size < addr || addr + size > VMALLOC_END)
+        return NULL;
+
+    struct vm_area *area = kmem_cache_alloc(&vm_area_cache);
+
+    if (!area)
+        return NULL;
+
+    area->addr  = addr;
+    area->size  = size;
+    area->flags = flags;
+    area->next  = *link;
+    *link = area;
+
+    vmalloc_used += size - PAGE_SIZE;
+
+    if (flags & (VM_PREFAULT | VM_STACK))
+        pmman.map(addr + PAGE_SIZE, size - PAGE_SIZE, KRW);
+
+    return (void *) (addr + PAGE_SIZE);
+}
+
+void vfree(void *ptr)
+{
+    uintptr_t addr = (uintptr_t) ptr;
+    struct vm_area **link = &vm_areas;
+
+    while (*link && !(addr >= (*link)->addr && addr < (*link)->addr + (*link)->size))
+        link = &(*link)->next;
+
+    if (!*link) /* Not allocated */
+        return;
+
+    struct vm_area *area = *link;
+    *link = area->next;
+
+    vmalloc_used -= area->size - PAGE_SIZE;
+
+    arch_tlb_batch_begin();
+    pmman.unmap(area->addr + PAGE_SIZE, area->size - PAGE_SIZE);
+    arch_tlb_batch_end();
+
+    kmem_cache_free(&vm_area_cache, area);
+}
+
+/* Handle a kernel page fault, returns 0 if the fault was resolved */
+int vmalloc_fault(uintptr_t addr)
+{
+    if (!IS_VMALLOC_ADDR(addr))
+        return -1;
+
+    struct vm_area *area = vm_area_find(addr);
+
+    if (!area)
+        return -1;
+
+    if (addr < area->addr + PAGE_SIZE) {
+        printk("Guard page hit at %p [area %p, size 0x%x]\n", addr, area->addr, area->size);
+
+        if (area->flags & VM_STACK)
+            panic("Kernel stack overflow");
+
+        panic("vmalloc area overflow");
+    }
+
+    pmman.map(addr & ~PAGE_MASK, PAGE_SIZE, KRW);
+    return 0;
+}
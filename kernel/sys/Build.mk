@@ -5,3 +5,5 @@ obj-y += fork.o
 obj-y += elf.o
 obj-y += execve.o
 obj-y += signal.o
+obj-y += timer.o
+obj-y += clock.o
@@ -0,0 +1,96 @@
+/**********************************************************************
+ *                  Time Keeping
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <mm/mm.h>
+#include <sys/sched.h>
+#include <sys/timer.h>
+#include <sys/clock.h>
+
+/*
+ *  The monotonic clock is advanced on every tick and published in the
+ *  clock data page, which is mapped user readable at CLOCK_PAGE. Userland
+ *  reads the TSC itself to get the time in between (see the clock_data
+ *  comment), so only the TSC can be exported as a clock source, others
+ *  leave tsc_mult at 0 and time has tick resolution.
+ */
+
+static char clock_page[PAGE_SIZE] __aligned(PAGE_SIZE);
+struct clock_data *clock_data = (struct clock_data *) clock_page;
+
+static struct clock_source *clock_source = NULL;
+static uint64_t clock_jiffies = 0;  /* jiffies at the last update */
+
+static uint64_t clock_cycles_to_ns(uint64_t cycles)
+{
+    uint64_t ns = 0;
+
+    /* Keeps the product in 64 bits, only long idle periods loop */
+    while (cycles >> 32) {
+        ns += ((uint64_t) 0x80000000 * clock_source->mult) >> clock_source->shift;
+        cycles -= 0x80000000;
+    }
+
+    return ns + (((uint64_t) (uint32_t) cycles * clock_source->mult) >> clock_source->shift);
+}
+
+void clock_init(struct clock_source *cs, uint32_t boot_time)
+{
+    clock_source = cs;
+    clock_jiffies = jiffies;
+
+    clock_data->boot_time = boot_time;
+
+    if (cs) {
+        clock_data->tsc_mult  = cs->mult;
+        clock_data->tsc_shift = cs->shift;
+        clock_data->tsc_base  = cs->read();
+    }
+
+    printk("[0] Kernel: Clock source -> %s\n", cs ? cs->name : "jiffies");
+
+    /* Same page in every address space, kept up to date through the kernel image */
+    pmman.map_to(LMA((uintptr_t) clock_page), CLOCK_PAGE, PAGE_SIZE, UR | MIO);
+}
+
+/* Called on every tick, and after ticks were skipped while idle */
+void clock_update()
+{
+    struct clock_data *cd = clock_data;
+    uint64_t now = 0, ns;
+
+    if (clock_source) {
+        now = clock_source->read();
+        ns  = clock_cycles_to_ns(now - cd->tsc_base);
+    } else {
+        ns = (jiffies - clock_jiffies) * TICK_NSEC;
+    }
+
+    clock_jiffies = jiffies;
+
+    uint32_t sec = cd->mono_sec;
+    ns += cd->mono_nsec;
+
+    while (ns >= NSEC_PER_SEC) {
+        ns -= NSEC_PER_SEC;
+        ++sec;
+    }
+
+    ++cd->seq;
+    asm volatile("":::"memory");
+
+    cd->tsc_base  = now;
+    cd->mono_sec  = sec;
+    cd->mono_nsec = ns;
+    cd->jiffies   = jiffies;
+
+    asm volatile("":::"memory");
+    ++cd->seq;
+}
@@ -13,9 +13,86 @@
 #include <core/string.h>
 #include <core/arch.h>
 
+#include <mm/mm.h>
+#include <mm/vma.h>
+
 #include <sys/proc.h>
 #include <sys/elf.h>
 
+#include <bits/errno.h>
+
+/*
+ * Create the areas of the image from its PT_LOAD segments, nothing is
+ * read here: file backed pages are faulted in from `file' on first touch
+ * and BSS is zero filled on demand. Returns the end of the image or 0 on
+ * failure.
+ */
+static uintptr_t elf_map_segments(struct fs_node *file, elf32_hdr_t *hdr, struct vma **vmas)
+{
+    uintptr_t proc_heap = 0;
+    size_t offset = hdr->phoff;
+
+    for (int i = 0; i < hdr->phnum; ++i) {
+        elf32_program_hdr_t phdr;
+        vfs.read(file, offset, sizeof(phdr), &phdr);
+        offset += hdr->phentsize;
+
+        if (phdr.type != PT_LOAD || !phdr.memsz)
+            continue;
+
+        /* Pages are mapped from the file, offsets must agree within a page */
+        if ((phdr.vaddr & PAGE_MASK) != (phdr.off & PAGE_MASK) || phdr.filesz > phdr.memsz)
+            return 0;
+
+        if (phdr.vaddr + phdr.memsz > USER_STACK_BASE || phdr.vaddr + phdr.memsz < phdr.vaddr)
+            return 0;
+
+        int prot = 0;
+        if (phdr.flags & PF_R) prot |= UR;
+        if (phdr.flags & PF_W) prot |= UW;
+        if (phdr.flags & PF_X) prot |= UX;
+
+        uintptr_t start = PAGE_ROUND_DOWN(phdr.vaddr);
+        uintptr_t data  = PAGE_ROUND_UP(phdr.vaddr + phdr.filesz);
+        uintptr_t end   = PAGE_ROUND_UP(phdr.vaddr + phdr.memsz);
+
+        if (phdr.filesz) {
+            struct vma *vma = vma_insert(vmas, start, data, prot, VMA_IMAGE, VMA_FILE);
+
+            if (!vma)   /* Segments sharing a page */
+                return 0;
+
+            vma->node   = file;
+            vma->off    = phdr.off - (phdr.vaddr - start);
+            vma->filesz = phdr.vaddr - start + phdr.filesz;
+            start = data;
+        }
+
+        /* Rest of BSS beyond the last file page */
+        if (end > start && !vma_insert(vmas, start, end, prot, VMA_IMAGE, VMA_ANON))
+            return 0;
+
+        if (end > proc_heap)
+            proc_heap = end;
+    }
+
+    /* Heap starts empty right after the image */
+    if (!proc_heap || !vma_insert(vmas, proc_heap, proc_heap, URW, VMA_HEAP, VMA_ANON))
+        return 0;
+
+    /* Stack pages are faulted in as it grows */
+    if (!vma_insert(vmas, USER_STACK_BASE, USER_STACK, URW, VMA_STACK, VMA_ANON))
+        return 0;
+
+    return proc_heap;
+}
+
+static int elf_check_header(elf32_hdr_t *hdr)
+{
+    return hdr->magic[0] == ELFMAG0 && hdr->magic[1] == ELFMAG1
+        && hdr->magic[2] == ELFMAG2 && hdr->magic[3] == ELFMAG3;
+}
+
 /* Loads an elf file into a new process skeleton */
 proc_t *load_elf(const char *fn)
 {
@@ -28,41 +105,24 @@ proc_t *load_elf(const char *fn)
     vfs.read(file, 0, sizeof(hdr), &hdr);
 
     /* Check header */
-    if (!(hdr.magic[0] == ELFMAG0 && hdr.magic[1] == ELFMAG1 && hdr.magic[2] == ELFMAG2 && hdr.magic[3] == ELFMAG3))
+    if (!elf_check_header(&hdr))
         return NULL;
 
-    uintptr_t proc_heap = 0;
-    size_t offset = hdr.shoff;
-    
-    for (int i = 0; i < hdr.shnum; ++i) {
-        elf32_section_hdr_t shdr;
-        vfs.read(file, offset, sizeof(shdr), &shdr);
-
-        if (shdr.flags & SHF_ALLOC) {
-            /* FIXME add some out-of-bounds handling code here */
-            pmman.map(shdr.addr, shdr.size, URWX);  /* FIXME URWX, are you serious? */
-        
-            if (shdr.type == SHT_PROGBITS) {
-                vfs.read(file, shdr.off, shdr.size, (void *) shdr.addr);
-            } else {
-                memset((void *) shdr.addr, 0, shdr.size);
-            }
-
-            if (shdr.addr + shdr.size > proc_heap)
-                proc_heap = shdr.addr + shdr.size;
-        }
+    struct vma *vmas = NULL;
+    uintptr_t proc_heap = elf_map_segments(file, &hdr, &vmas);
 
-        offset += hdr.shentsize;
+    if (!proc_heap) {
+        vma_unmap_all(&vmas);
+        return NULL;
     }
 
-    pmman.map(USER_STACK_BASE, USER_STACK_SIZE, URW);
-
     proc_t *proc = new_proc();
     //proc->name = strdup(file->name);
     proc->name = strdup(fn);
     proc->heap_start = proc_heap;
     proc->heap = proc_heap;
     proc->entry = hdr.entry;
+    proc->vmas = vmas;
 
     arch_init_proc(arch_specific_data, proc);
     arch_load_elf_end(arch_specific_data);
@@ -70,45 +130,34 @@ proc_t *load_elf(const char *fn)
     return proc;
 }
 
-/* Loads an elf file into an existing process skeleton */
-proc_t *load_elf_proc(proc_t *proc, const char *fn)
+/* Loads an elf file into an existing process skeleton, returns 0 or -errno */
+int load_elf_proc(proc_t *proc, const char *fn)
 {
     struct fs_node *file = vfs.find(fn);
-    if (!file) return NULL;
-
-    pmman.unmap_full(0, proc->heap);
+    if (!file) return -ENOENT;
 
     elf32_hdr_t hdr;
     vfs.read(file, 0, sizeof(hdr), &hdr);
 
     /* Check header */
-    if (!(hdr.magic[0] == ELFMAG0 && hdr.magic[1] == ELFMAG1 && hdr.magic[2] == ELFMAG2 && hdr.magic[3] == ELFMAG3))
-        return NULL;
+    if (!elf_check_header(&hdr))
+        return -ENOEXEC;
 
-    uintptr_t proc_heap = 0;
-    size_t offset = hdr.shoff;
-    
-    for (int i = 0; i < hdr.shnum; ++i) {
-        elf32_section_hdr_t shdr;
-        vfs.read(file, offset, sizeof(shdr), &shdr);
-        
-        if (shdr.flags & SHF_ALLOC) {
-            /* FIXME add some out-of-bounds handling code here */
-            pmman.map(shdr.addr, shdr.size, URWX);  /* FIXME URWX, are you serious? */
-
-            if (shdr.type == SHT_PROGBITS) {
-                vfs.read(file, shdr.off, shdr.size, (void *) shdr.addr);
-            } else {
-                memset((void *) shdr.addr, 0, shdr.size);
-            }
-
-            if (shdr.addr + shdr.size > proc_heap)
-                proc_heap = shdr.addr + shdr.size;
-        }
+    /* Tear down the old image, a vfork child hands it back instead */
+    if (proc->vforked) {
+        int err = vfork_release(proc, 1);
 
-        offset += hdr.shentsize;
+        if (err)
+            return err;
+    } else {
+        vma_unmap_all(&proc->vmas);
     }
 
+    uintptr_t proc_heap = elf_map_segments(file, &hdr, &proc->vmas);
+
+    if (!proc_heap) /* FIXME: The old image is gone, kill the process */
+        return -ENOEXEC;
+
     kfree(proc->name);
     //proc->name = strdup(file->name);
     proc->name = strdup(fn);
@@ -116,5 +165,5 @@ proc_t *load_elf_proc(proc_t *proc, const char *fn)
     proc->heap = proc_heap;
     proc->entry = hdr.entry;
 
-    return proc;
+    return 0;
 }
@@ -3,9 +3,13 @@
 #include <core/arch.h>
 #include <sys/proc.h>
 #include <sys/elf.h>
+#include <sys/sched.h>
 #include <mm/mm.h>
 
-proc_t *execve_proc(proc_t *proc, const char *fn, char * const _argp[], char * const _envp[])
+#include <bits/errno.h>
+
+/* Replaces the image of `proc' with `fn', returns 0 or -errno */
+int execve_proc(proc_t *proc, const char *fn, char * const _argp[], char * const _envp[])
 {
 
     char **u_argp = (char **) _argp;
@@ -24,6 +28,12 @@ proc_t *execve_proc(proc_t *proc, const char *fn, char * const _argp[], char * c
     char **argp = kmalloc((argc + 1) * sizeof(char *));
     char **envp = kmalloc((envc + 1) * sizeof(char *));
 
+    if (!argp || !envp) {
+        if (argp) kfree(argp);
+        if (envp) kfree(envp);
+        return -ENOMEM;
+    }
+
     argp[argc] = NULL;
     envp[envc] = NULL;
 
@@ -33,9 +43,9 @@ proc_t *execve_proc(proc_t *proc, const char *fn, char * const _argp[], char * c
     for (int i = 0; i < envc; ++i)
         envp[i] = strdup(u_envp[i]);
 
-    proc_t *p = load_elf_proc(proc, fn);
+    int err = load_elf_proc(proc, fn);
     
-    if (!p) {
+    if (err) {
         /* Free used resources */
         for (int i = 0; i < argc + 1; ++i)
             kfree(argp[i]);
@@ -44,12 +54,12 @@ proc_t *execve_proc(proc_t *proc, const char *fn, char * const _argp[], char * c
         for (int i = 0; i < envc + 1; ++i)
             kfree(envp[i]);
         kfree(envp);
-        return NULL;
+        return err;
     }
 
-    p->spawned = 0;
+    proc->spawned = 0;
     
-    arch_sys_execve(p, argc + 1, argp, envc + 1, envp);
+    arch_sys_execve(proc, argc + 1, argp, envc + 1, envp);
 
     /* Free used resources */
     for (int i = 0; i < argc + 1; ++i)
@@ -60,5 +70,37 @@ proc_t *execve_proc(proc_t *proc, const char *fn, char * const _argp[], char * c
         kfree(envp[i]);
     kfree(envp);
     
-    return p;
+    return 0;
+}
+
+/*
+ *  Starts `fn' in a new child of `proc', without copying `proc' first.
+ *  Returns the pid of the child or -errno.
+ */
+int posix_spawn_proc(proc_t *proc, const char *fn, char * const argp[], char * const envp[])
+{
+    /* Start as a vfork child, execve_proc then moves it to its own address space */
+    proc_t *spawn = vfork_proc(proc);
+
+    if (!spawn) /* Could not allocate the child */
+        return -ENOMEM;
+
+    /* Load in the child context, so faults on its new stack find its areas */
+    cur_proc = spawn;
+    int err = execve_proc(spawn, fn, argp, envp);
+
+    if (err)
+        kill_proc(spawn);
+
+    cur_proc = proc;
+    arch_switch_mm(proc);
+
+    if (err) {
+        reap_proc(spawn);
+        return err;
+    }
+
+    make_ready(spawn);
+
+    return spawn->pid;
 }
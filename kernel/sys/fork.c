@@ -13,10 +13,12 @@
 #include <core/string.h>
 #include <core/arch.h>
 #include <mm/mm.h>
+#include <mm/slab.h>
+#include <mm/vma.h>
 #include <sys/proc.h>
 #include <ds/queue.h>
 
-proc_t *fork_proc(proc_t *proc)
+static proc_t *new_fork(proc_t *proc)
 {
     /* Copy parent proc structure */
     proc_t *fork = new_proc();
@@ -27,26 +29,113 @@ proc_t *fork_proc(proc_t *proc)
     fork->parent = proc;
     fork->spawned = 1;
     fork->cwd = strdup(proc->cwd);
+    fork->vmas = NULL;
+    fork->vforked = 0;
+    fork->vfork_lent = 0;
+    fork->sleep_queue = NULL;
+    fork->utime = fork->stime = 0;
+    fork->cutime = fork->cstime = 0;
+    proc_timers_init(fork);
     
     /* Allocate new signals queue */
     fork->signals_queue = new_queue();
 
     /* Copy open files descriptors */
-    fork->fds = kmalloc(FDS_COUNT * sizeof(struct file));
+    fork->fds = kmem_cache_alloc(&fds_cache);
     memcpy(fork->fds, proc->fds, FDS_COUNT * sizeof(struct file));
 
+    return fork;
+}
+
+static void free_fork(proc_t *fork)
+{
+    extern queue_t *procs;
+    queue_remove(procs, fork);
+
+    kmem_cache_free(&fds_cache, fork->fds);
+    free_queue(fork->signals_queue);
+    kfree(fork->name);
+    kfree(fork->cwd);
+    kmem_cache_free(&proc_cache, fork);
+}
+
+proc_t *fork_proc(proc_t *proc)
+{
+    proc_t *fork = new_fork(proc);
+
+    /* Copy memory areas, mappings are shared copy-on-write by arch code */
+    int retval = vma_dup(&fork->vmas, proc->vmas);
+
     /* Call arch specific fork handler */
-    int retval = arch_sys_fork(fork);
+    if (!retval)
+        retval = arch_sys_fork(fork);
+
+    if (!retval) {
+        arch_syscall_return(fork, 0);
+        arch_syscall_return(proc, fork->pid);
+    } else {
+        arch_syscall_return(proc, retval);
+        vma_free_all(&fork->vmas);
+        free_fork(fork);
+        return NULL;
+    }
+
+    return fork;
+}
+
+/*
+ *  A vfork child runs in its parent's address space (and on its user stack)
+ *  until it calls execve or exits, the parent is suspended meanwhile. Nothing
+ *  is copied, which makes it the cheap way to start a new program.
+ */
+
+proc_t *vfork_proc(proc_t *proc)
+{
+    proc_t *fork = new_fork(proc);
+
+    /* Borrow the memory areas, handed back by vfork_release */
+    fork->vmas = proc->vmas;
+    fork->vforked = 1;
+
+    int retval = arch_sys_vfork(fork);
 
     if (!retval) {
         arch_syscall_return(fork, 0);
         arch_syscall_return(proc, fork->pid);
+
+        /* Killing the parent or running its signal handlers would pull
+         * the memory and the stack from under the child */
+        proc->vfork_lent = 1;
     } else {
         arch_syscall_return(proc, retval);
-        kfree(fork->fds);
-        kfree(fork);
+        fork->vmas = NULL;
+        free_fork(fork);
         return NULL;
     }
 
     return fork;
 }
+
+/* Give the borrowed address space back to the parent and let it run again */
+int vfork_release(proc_t *proc, int exec)
+{
+    proc_t *parent = proc->parent;
+
+    /* On execve the child moves to an address space of its own */
+    int retval = arch_vfork_release(proc, exec);
+
+    if (retval)
+        return retval;
+
+    /* The child might have changed the areas (sbrk, mmap, ...) */
+    parent->vmas = proc->vmas;
+    parent->heap = proc->heap;
+
+    proc->vmas = NULL;
+    proc->vforked = 0;
+    parent->vfork_lent = 0;
+
+    wakeup_queue(&parent->wait_queue);
+
+    return 0;
+}
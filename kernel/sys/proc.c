@@ -14,17 +14,25 @@
 #include <core/arch.h>
 
 #include <mm/mm.h>
+#include <mm/slab.h>
+#include <mm/vma.h>
 
 #include <sys/proc.h>
 #include <sys/elf.h>
 #include <sys/sched.h>
+#include <sys/signal.h>
 
 #include <fs/vfs.h>
 
+#include <bits/errno.h>
+
 #include <ds/queue.h>
 
 queue_t *procs = NEW_QUEUE; /* All processes queue */
 
+struct kmem_cache proc_cache = KMEM_CACHE_INIT("proc_t", sizeof(proc_t), SLAB_CACHE_LINE, NULL);
+struct kmem_cache fds_cache  = KMEM_CACHE_INIT("fds", FDS_COUNT * sizeof(struct file), SLAB_CACHE_LINE, NULL);
+
 int get_pid()
 {
     static int pid = 0;
@@ -33,7 +41,8 @@ int get_pid()
 
 proc_t *new_proc()
 {
-    proc_t *proc = kmalloc(sizeof(proc_t));
+    proc_t *proc = kmem_cache_alloc(&proc_cache);
+    memset(proc, 0, sizeof(proc_t));
     enqueue(procs, proc);   /* Add process to all processes queue */
     return proc;
 }
@@ -53,10 +62,28 @@ void init_process(proc_t *proc)
 {
     proc->pid = get_pid();
 
-    proc->fds  = kmalloc(FDS_COUNT * sizeof(struct file));
+    proc->fds  = kmem_cache_alloc(&fds_cache);
     memset(proc->fds, 0, FDS_COUNT * sizeof(struct file));
 
     proc->signals_queue = new_queue();  /* Initalize signals queue */
+    proc_timers_init(proc);
+}
+
+static void sleep_timeout(void *arg)
+{
+    proc_t *proc = arg;
+
+    if (proc->sleep_queue)
+        queue_remove(proc->sleep_queue, proc);
+
+    make_ready(proc);
+}
+
+/* Timers are not inherited, they are armed by the process itself */
+void proc_timers_init(proc_t *proc)
+{
+    timer_init(&proc->sleep_timer, sleep_timeout, proc);
+    itimer_init(proc);
 }
 
 void kill_proc(proc_t *proc)
@@ -67,17 +94,18 @@ void kill_proc(proc_t *proc)
     if (last_fpu_proc == proc)
         last_fpu_proc = NULL;
 
-    /* Unmap memory */
-    pmman.unmap_full((uintptr_t) NULL, (uintptr_t) proc->heap);
-    pmman.unmap_full(USER_STACK_BASE, USER_STACK_SIZE);
+    /* Unmap memory, unless it is borrowed from the parent */
+    if (proc->vforked)
+        vfork_release(proc, 0);
+    else
+        vma_unmap_all(&proc->vmas);
 
-    /* Free kernel-space resources */
-    kfree(proc->fds);
-
-    while (proc->signals_queue->count)
-        dequeue(proc->signals_queue);
+    timer_del(&proc->sleep_timer);
+    timer_del(&proc->itimer);
 
-    kfree(proc->signals_queue);
+    /* Free kernel-space resources */
+    kmem_cache_free(&fds_cache, proc->fds);
+    free_queue(proc->signals_queue);
 
     /* Make parent inherit all children */
     forlinked (node, procs->head, node->next) {
@@ -94,8 +122,14 @@ void reap_proc(proc_t *proc)
 {
     queue_remove(procs, proc);
 
+    if (proc->parent) {
+        proc->parent->cutime += proc->utime + proc->cutime;
+        proc->parent->cstime += proc->stime + proc->cstime;
+    }
+
+    arch_reap_proc(proc);
     kfree(proc->name);
-    kfree(proc);
+    kmem_cache_free(&proc_cache, proc);
 }
 
 int get_fd(proc_t *proc)
@@ -120,10 +154,15 @@ void release_fd(proc_t *proc, int fd)
 int sleep_on(queue_t *queue)
 {
     printk("[%d] %s: Sleeping on queue %p\n", cur_proc->pid, cur_proc->name, queue);
-    enqueue(queue, cur_proc);
+    if (queue)
+        enqueue(queue, cur_proc);
+
+    cur_proc->sleep_queue = queue;
     cur_proc->state = ISLEEP;
     arch_sleep();
 
+    cur_proc->sleep_queue = NULL;
+
     /* Woke up */
     if (cur_proc->state != ISLEEP) {
         /* A signal interrupted the sleep */
@@ -135,6 +174,22 @@ int sleep_on(queue_t *queue)
     }
 }
 
+/*
+ *  Like sleep_on, but gives up after `ticks' clock ticks, returns -ETIMEDOUT
+ *  then. A NULL queue sleeps until the timeout or a signal.
+ */
+int sleep_on_timeout(queue_t *queue, uint32_t ticks)
+{
+    timer_add(&cur_proc->sleep_timer, jiffies + ticks);
+
+    int ret = sleep_on(queue);
+
+    if (!timer_del(&cur_proc->sleep_timer) && !ret)
+        return -ETIMEDOUT;
+
+    return ret;
+}
+
 void wakeup_queue(queue_t *queue)
 {
     //printk("wakeup_queue(queue=%p)\n", queue);
@@ -147,8 +202,5 @@ void wakeup_queue(queue_t *queue)
 
 int validate_ptr(proc_t *proc, void *ptr)
 {
-    uintptr_t uptr = (uintptr_t) ptr;
-    if (!(uptr >= proc->entry && uptr <= proc->heap))
-        return 0;
-    return 1;
+    return !!vma_find(proc->vmas, (uintptr_t) ptr);
 }
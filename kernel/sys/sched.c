@@ -3,23 +3,157 @@
 #include <core/arch.h>
 #include <sys/proc.h>
 #include <sys/sched.h>
-#include <ds/queue.h>
+#include <sys/timer.h>
+#include <sys/clock.h>
+
+/*
+ *  Ready processes are kept in one FIFO per priority level, linked through
+ *  proc_t itself, with a bitmap of the non-empty levels. Picking the next
+ *  process is finding the first set bit, however many processes there are.
+ *
+ *  The priority of a process is its nice value lowered by a boost. The
+ *  boost is given back in full every time the process wakes up from sleep
+ *  and loses a step on every tick it runs for, so processes waiting on I/O
+ *  (fbterm on /dev/kbd for instance) win over CPU hogs once woken up.
+ *
+ *  Priorities alone would let a nice 0 hog starve every niced process, or
+ *  a process sleeping every few ticks keep its boost forever. Every process
+ *  gets a time slice by its nice value, once used up it goes to the expired
+ *  array and only runs again after everyone in the active array did. The
+ *  arrays are swapped when the active one runs empty. Sleeping does not
+ *  give a slice back, only expiring does.
+ */
+
+#define NR_PRIO             (NICE_MAX - NICE_MIN + 1)
+#define NICE_TO_PRIO(nice)  ((nice) - NICE_MIN)
+#define SCHED_BOOST_MAX     5
+
+/* Ticks per slice, from 200ms at NICE_MIN down to 10ms at NICE_MAX (HZ 100) */
+#define SCHED_SLICE(nice)   MAX((NICE_MAX + 1 - (nice)) * HZ / 200, 1)
+
+struct run_queue {
+    proc_t *head;
+    proc_t *tail;
+};
+
+static struct prio_array {
+    size_t nr;  /* Processes queued */
+    uint32_t bitmap[(NR_PRIO + 31) / 32];
+    struct run_queue queues[NR_PRIO];
+} prio_arrays[2];
+
+static struct prio_array *active  = &prio_arrays[0];
+static struct prio_array *expired = &prio_arrays[1];
 
-queue_t *ready_queue = NEW_QUEUE;   /* Ready processes queue */
 proc_t *cur_proc = NULL;
+int need_resched = 0;
+volatile uint64_t jiffies = 0;
+
+static inline int proc_prio(proc_t *proc)
+{
+    return MAX(NICE_TO_PRIO(proc->nice) - proc->boost, 0);
+}
+
+static proc_t *pick_next()
+{
+    /* Everyone active had their turn */
+    if (!active->nr) {
+        struct prio_array *tmp = active;
+        active = expired;
+        expired = tmp;
+    }
+
+    for (size_t i = 0; i < sizeof(active->bitmap)/sizeof(active->bitmap[0]); ++i) {
+        if (!active->bitmap[i])
+            continue;
+
+        int prio = i * 32 + __builtin_ctz(active->bitmap[i]);
+        struct run_queue *rq = &active->queues[prio];
+        proc_t *proc = rq->head;
+
+        if (!(rq->head = proc->sched_next)) {
+            rq->tail = NULL;
+            active->bitmap[i] &= ~_BV(prio % 32);
+        }
+
+        --active->nr;
+        proc->sched_next = NULL;
+        proc->ready = 0;
+
+        return proc;
+    }
+
+    return NULL;
+}
 
 void make_ready(proc_t *proc)
 {
-    enqueue(ready_queue, proc);
+    /* Already queued, could be woken up twice */
+    if (proc->ready)
+        return;
+
+    /* Woken up from sleep */
+    if (proc->state == ISLEEP || proc->state == USLEEP)
+        proc->boost = SCHED_BOOST_MAX;
+
+    struct prio_array *array = active;
+
+    /* Used up its slice, wait for the others and start a new one */
+    if (proc->slice_used >= SCHED_SLICE(proc->nice)) {
+        proc->slice_used = 0;
+        array = expired;
+    }
+
+    int prio = proc_prio(proc);
+    struct run_queue *rq = &array->queues[prio];
+
+    proc->sched_next = NULL;
+    proc->ready = 1;
+
+    if (rq->tail)
+        rq->tail->sched_next = proc;
+    else
+        rq->head = proc;
+
+    rq->tail = proc;
+    array->bitmap[prio / 32] |= _BV(prio % 32);
+    ++array->nr;
+
+    /* Preempt the current process on the way out of the kernel */
+    if (!cur_proc || kidle || (array == active && prio < proc_prio(cur_proc)))
+        need_resched = 1;
+}
+
+/* Called on every timer tick, the running process used up a tick of its slice */
+void sched_tick(int user)
+{
+    ++jiffies;
+    clock_update();
+    timer_run();
+
+    if (cur_proc && !kidle) {
+        if (user)
+            ++cur_proc->utime;
+        else
+            ++cur_proc->stime;
+
+        if (cur_proc->boost)
+            --cur_proc->boost;
+
+        /* Slice used up, let the others have a go */
+        if (++cur_proc->slice_used >= SCHED_SLICE(cur_proc->nice))
+            need_resched = 1;
+    }
 }
 
-int kidle = 0;
-void kernel_idle()
+int sched_nice(proc_t *proc, int incr)
 {
-    kidle = 1;
-    arch_idle();
+    proc->nice = MIN(MAX(proc->nice + incr, NICE_MIN), NICE_MAX);
+    return proc->nice;
 }
 
+int kidle = 0;
+
 void spawn_proc(proc_t *proc)   /* Starts process execution */
 {
     proc->spawned = 1;
@@ -36,23 +170,27 @@ void spawn_init(proc_t *init)
     spawn_proc(init);
 }
 
-void schedule() /* Called from arch-specific timer event handler */
+/*
+ *  Switch to the next ready process. The current process is queued again
+ *  unless it went to sleep or died, we return here once it is picked again.
+ *  With nothing ready we switch to the idle context (cur_proc is NULL then).
+ */
+void schedule()
 {
-    if (!ready_queue)    /* How did we even get here? */
-        panic("Processes queue is not initialized");
+    proc_t *prev = cur_proc;
 
-    if (!kidle)
-        make_ready(cur_proc);
+    if (prev && prev->state == RUNNABLE)
+        make_ready(prev);
 
-    kidle = 0;
+    need_resched = 0;
 
-    if (!ready_queue->count) /* No ready processes, idle */
-        kernel_idle();
+    proc_t *next = pick_next();
 
-    cur_proc = dequeue(ready_queue);
+    if (next == prev)   /* Keep running, or keep idling */
+        return;
 
-    if (cur_proc->spawned)
-        arch_switch_proc(cur_proc);
-    else
-        spawn_proc(cur_proc);
+    cur_proc = next;
+    kidle = !next;
+
+    arch_switch_proc(prev, next);
 }
@@ -59,10 +59,74 @@ int send_signal(pid_t pid, int signal)
         if (!proc) {
             return -ESRCH;
         } else {
-            enqueue(proc->signals_queue, (void *) signal);
+            signal_proc(proc, signal);
             return 0;
         }
     }
     
     return 0;
 }
+
+/* Queue a signal for a process other than the current one */
+void signal_proc(proc_t *proc, int signal)
+{
+    enqueue(proc->signals_queue, (void *) signal);
+
+    /* Interrupt its sleep, it gets the signal once it runs */
+    if (proc->state == ISLEEP) {
+        if (proc->sleep_queue)
+            queue_remove(proc->sleep_queue, proc);
+
+        proc->sleep_queue = NULL;
+        proc->state = RUNNABLE;
+        make_ready(proc);
+    }
+}
+
+/* ================== Interval Timers ================== */
+
+static void itimer_expire(void *arg)
+{
+    proc_t *proc = arg;
+
+    /* Periodic timers are re-armed from when they were due, not from now */
+    if (proc->itimer_interval)
+        timer_add(&proc->itimer, proc->itimer.expires + proc->itimer_interval);
+
+    signal_proc(proc, SIGALRM);
+}
+
+void itimer_init(proc_t *proc)
+{
+    timer_init(&proc->itimer, itimer_expire, proc);
+    proc->itimer_interval = 0;
+}
+
+int itimer_set(proc_t *proc, const struct itimerval *value, struct itimerval *ovalue)
+{
+    if (value && (value->it_value.tv_usec < 0 || value->it_value.tv_usec >= 1000000
+            || value->it_interval.tv_usec < 0 || value->it_interval.tv_usec >= 1000000
+            || value->it_value.tv_sec < 0 || value->it_interval.tv_sec < 0))
+        return -EINVAL;
+
+    if (ovalue) {
+        uint32_t left = 0;
+
+        if (timer_pending(&proc->itimer) && proc->itimer.expires > jiffies)
+            left = proc->itimer.expires - jiffies;
+
+        ticks_to_timeval(left, &ovalue->it_value);
+        ticks_to_timeval(proc->itimer_interval, &ovalue->it_interval);
+    }
+
+    if (!value)
+        return 0;
+
+    timer_del(&proc->itimer);
+    proc->itimer_interval = timeval_to_ticks(&value->it_interval);
+
+    if (value->it_value.tv_sec || value->it_value.tv_usec)
+        timer_add(&proc->itimer, jiffies + timeval_to_ticks(&value->it_value));
+
+    return 0;
+}
@@ -13,13 +13,18 @@
 #include <core/string.h>
 #include <core/arch.h>
 
+#include <mm/vma.h>
+
 #include <sys/proc.h>
 #include <sys/sched.h>
 #include <sys/signal.h>
+#include <sys/timer.h>
 
 #include <bits/errno.h>
 #include <bits/dirent.h>
 #include <bits/utsname.h>
+#include <bits/time.h>
+#include <bits/poll.h>
 
 #include <fs/devpts.h>
 #include <fs/pipe.h>
@@ -66,13 +71,13 @@ static void sys_execve(const char *path, char *const argp[], char *const envp[])
     //    return -ENOENT;
 
     char *fn = strdup(path);
-    proc_t *p = execve_proc(cur_proc, fn, argp, envp);
+    int err = execve_proc(cur_proc, fn, argp, envp);
     kfree(fn);
 
-    if (!p)
-        arch_syscall_return(cur_proc, -1);
+    if (err)
+        arch_syscall_return(cur_proc, err);
     else
-        spawn_proc(p);
+        spawn_proc(cur_proc);
 }
 
 static void sys_fork(void)
@@ -226,6 +231,12 @@ static void sys_sbrk(ptrdiff_t incr)
     printk("[%d] %s: sbrk(incr=%d, 0x%x)\n", cur_proc->pid, cur_proc->name, incr, incr);
 
     uintptr_t ret = cur_proc->heap;
+
+    if (vma_brk(cur_proc->vmas, cur_proc->heap + incr)) {
+        arch_syscall_return(cur_proc, -1);
+        return;
+    }
+
     cur_proc->heap += incr;
 
     arch_syscall_return(cur_proc, ret);
@@ -238,9 +249,31 @@ static void sys_stat()
 
 }
 
-static void sys_times()
+/*
+ *  Scheduler ticks to CLK_TCK units for any HZ, whole seconds are split off
+ *  first so that the 64 by 32 bit division cannot overflow. Wraps around.
+ */
+static uint32_t ticks_to_clk(uint64_t ticks)
 {
+    uint32_t sec = div_u64_u32(ticks, HZ);
+    uint32_t rem = ticks - (uint64_t) sec * HZ;
 
+    return sec * CLK_TCK + rem * CLK_TCK / HZ;
+}
+
+static void sys_times(struct tms *buf)
+{
+    printk("[%d] %s: times(buf=%p)\n", cur_proc->pid, cur_proc->name, buf);
+
+    if (buf) {
+        buf->tms_utime  = ticks_to_clk(cur_proc->utime);
+        buf->tms_stime  = ticks_to_clk(cur_proc->stime);
+        buf->tms_cutime = ticks_to_clk(cur_proc->cutime);
+        buf->tms_cstime = ticks_to_clk(cur_proc->cstime);
+    }
+
+    /* Elapsed real time */
+    arch_syscall_return(cur_proc, ticks_to_clk(jiffies));
 }
 
 static void sys_unlink()
@@ -497,6 +530,146 @@ static void sys_getcwd(char *buf, size_t size)
     arch_syscall_return(cur_proc, 0);
 }
 
+struct mmap_args {
+    void *addr;
+    size_t len;
+    int prot;
+    int flags;
+    int fildes;
+    off_t off;
+} __packed;
+
+static void sys_mmap(struct mmap_args *args)
+{
+    printk("[%d] %s: mmap(addr=%p, len=%d, prot=0x%x, flags=0x%x, fildes=%d, off=%d)\n",
+            cur_proc->pid, cur_proc->name, args->addr, args->len, args->prot, args->flags, args->fildes, args->off);
+
+    uintptr_t ret = vma_mmap((uintptr_t) args->addr, args->len, args->prot, args->flags, args->fildes, args->off);
+    arch_syscall_return(cur_proc, ret);
+}
+
+static void sys_munmap(void *addr, size_t len)
+{
+    printk("[%d] %s: munmap(addr=%p, len=%d)\n", cur_proc->pid, cur_proc->name, addr, len);
+
+    int ret = vma_munmap((uintptr_t) addr, len);
+    arch_syscall_return(cur_proc, ret);
+}
+
+static void sys_mprotect(void *addr, size_t len, int prot)
+{
+    printk("[%d] %s: mprotect(addr=%p, len=%d, prot=0x%x)\n", cur_proc->pid, cur_proc->name, addr, len, prot);
+
+    int ret = vma_mprotect((uintptr_t) addr, len, prot);
+    arch_syscall_return(cur_proc, ret);
+}
+
+static void sys_vfork(void)
+{
+    printk("[%d] %s: vfork()\n", cur_proc->pid, cur_proc->name);
+
+    proc_t *fork = vfork_proc(cur_proc);
+
+    /* Returns are handled inside vfork_proc */
+
+    if (!fork)
+        return;
+
+    make_ready(fork);
+
+    /* The child is running on our stack, wait until it execs or exits */
+    while (fork->vforked)
+        sleep_on(&cur_proc->wait_queue);
+}
+
+struct posix_spawn_args {
+    pid_t *pid;
+    const char *path;
+    char *const *argp;
+    char *const *envp;
+} __packed;
+
+static void sys_posix_spawn(struct posix_spawn_args *args)
+{
+    printk("[%d] %s: posix_spawn(pid=%p, path=%s, argp=%p, envp=%p)\n",
+            cur_proc->pid, cur_proc->name, args->pid, args->path, args->argp, args->envp);
+
+    char *fn = strdup(args->path);
+    int pid = posix_spawn_proc(cur_proc, fn, args->argp, args->envp);
+    kfree(fn);
+
+    if (pid < 0) {
+        arch_syscall_return(cur_proc, pid);
+        return;
+    }
+
+    if (args->pid)
+        *args->pid = pid;
+
+    arch_syscall_return(cur_proc, 0);
+}
+
+static void sys_nice(int incr)
+{
+    printk("[%d] %s: nice(incr=%d)\n", cur_proc->pid, cur_proc->name, incr);
+
+    int ret = sched_nice(cur_proc, incr);
+    arch_syscall_return(cur_proc, ret);
+}
+
+static void sys_nanosleep(const struct timespec *req, struct timespec *rem)
+{
+    printk("[%d] %s: nanosleep(req=%p, rem=%p)\n", cur_proc->pid, cur_proc->name, req, rem);
+
+    if (req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000) {
+        arch_syscall_return(cur_proc, -EINVAL);
+        return;
+    }
+
+    /* One more tick, the current one is already partly gone */
+    uint32_t ticks = timespec_to_ticks(req) + 1;
+    int ret = sleep_on_timeout(NULL, ticks);
+
+    if (ret == -ETIMEDOUT) {
+        arch_syscall_return(cur_proc, 0);
+        return;
+    }
+
+    if (rem) {
+        uint64_t expires = cur_proc->sleep_timer.expires;
+        ticks_to_timespec(expires > jiffies ? expires - jiffies : 0, rem);
+    }
+
+    arch_syscall_return(cur_proc, -EINTR);
+}
+
+static void sys_setitimer(int which, const struct itimerval *value, struct itimerval *ovalue)
+{
+    printk("[%d] %s: setitimer(which=%d, value=%p, ovalue=%p)\n", cur_proc->pid, cur_proc->name, which, value, ovalue);
+
+    /* No CPU time accounting, only real time timers */
+    if (which != ITIMER_REAL) {
+        arch_syscall_return(cur_proc, -EINVAL);
+        return;
+    }
+
+    int ret = itimer_set(cur_proc, value, ovalue);
+    arch_syscall_return(cur_proc, ret);
+}
+
+static void sys_poll(struct pollfd *fds, size_t nfds, int timeout)
+{
+    printk("[%d] %s: poll(fds=%p, nfds=%d, timeout=%d)\n", cur_proc->pid, cur_proc->name, fds, nfds, timeout);
+
+    if (nfds > FDS_COUNT) {
+        arch_syscall_return(cur_proc, -EINVAL);
+        return;
+    }
+
+    int ret = generic_poll(fds, nfds, timeout);
+    arch_syscall_return(cur_proc, ret);
+}
+
 void (*syscall_table[])() =  {
     /* 00 */    NULL,
     /* 01 */    sys_exit,
@@ -527,4 +700,13 @@ void (*syscall_table[])() =  {
     /* 26 */    sys_fcntl,
     /* 27 */    sys_chdir,
     /* 28 */    sys_getcwd,
+    /* 29 */    sys_mmap,
+    /* 30 */    sys_munmap,
+    /* 31 */    sys_mprotect,
+    /* 32 */    sys_vfork,
+    /* 33 */    sys_posix_spawn,
+    /* 34 */    sys_nice,
+    /* 35 */    sys_nanosleep,
+    /* 36 */    sys_setitimer,
+    /* 37 */    sys_poll,
 };
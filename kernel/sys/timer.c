@@ -0,0 +1,181 @@
+/**********************************************************************
+ *                  Kernel Timers
+ *
+ *
+ *  This file is part of Aquila OS and is released under the terms of
+ *  GNU GPLv3 - See LICENSE.
+ *
+ *  Copyright (C) 2017 Mohamed Anwar <mohamed_anwar@opmbx.org>
+ */
+
+#include <core/system.h>
+#include <sys/sched.h>
+#include <sys/timer.h>
+
+/*
+ *  Hierarchical timer wheel. The first level has a slot for each of the
+ *  next 256 ticks, every level after that covers 64 times the span of the
+ *  one before it. Adding and deleting timers is a list operation on one
+ *  slot. Every time the first level wraps around, the next slot of the
+ *  level above is cascaded down, so timers get sorted a bit more each
+ *  time they move down a level, and only when they get close to expiring.
+ */
+
+#define TVR_BITS    8
+#define TVN_BITS    6
+#define TVR_SIZE    (1 << TVR_BITS)
+#define TVN_SIZE    (1 << TVN_BITS)
+#define TVR_MASK    (TVR_SIZE - 1)
+#define TVN_MASK    (TVN_SIZE - 1)
+#define TVN_LEVELS  4
+
+#define TVN_SHIFT(level)    (TVR_BITS + (level) * TVN_BITS)
+#define TVN_INDEX(j, level) (((j) >> TVN_SHIFT(level)) & TVN_MASK)
+
+static struct timer *tv1[TVR_SIZE];
+static struct timer *tvn[TVN_LEVELS][TVN_SIZE];
+
+/* The next tick to process, catches up with jiffies in timer_run */
+static uint64_t timer_jiffies = 0;
+
+static void timer_link(struct timer **slot, struct timer *timer)
+{
+    if ((timer->next = *slot))
+        (*slot)->pprev = &timer->next;
+
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void timer_unlink(struct timer *timer)
+{
+    if ((*timer->pprev = timer->next))
+        timer->next->pprev = timer->pprev;
+
+    timer->next  = NULL;
+    timer->pprev = NULL;
+}
+
+static void timer_enqueue(struct timer *timer)
+{
+    uint64_t expires = timer->expires;
+
+    /* Already expired, runs on the next tick processed */
+    if (expires < timer_jiffies) {
+        timer_link(&tv1[timer_jiffies & TVR_MASK], timer);
+        return;
+    }
+
+    uint64_t delta = expires - timer_jiffies;
+
+    if (delta < TVR_SIZE) {
+        timer_link(&tv1[expires & TVR_MASK], timer);
+        return;
+    }
+
+    for (int level = 0; level < TVN_LEVELS - 1; ++level) {
+        if (delta < (1ULL << TVN_SHIFT(level + 1))) {
+            timer_link(&tvn[level][TVN_INDEX(expires, level)], timer);
+            return;
+        }
+    }
+
+    if (delta > TIMER_MAX_TICKS)
+        expires = timer->expires = timer_jiffies + TIMER_MAX_TICKS;
+
+    timer_link(&tvn[TVN_LEVELS - 1][TVN_INDEX(expires, TVN_LEVELS - 1)], timer);
+}
+
+/* Spread the timers of a slot over the levels below, returns the slot index */
+static int timer_cascade(int level, int index)
+{
+    struct timer *list = tvn[level][index];
+    tvn[level][index] = NULL;
+
+    while (list) {
+        struct timer *timer = list;
+        list = timer->next;
+        timer_enqueue(timer);
+    }
+
+    return index;
+}
+
+void timer_init(struct timer *timer, void (*fn)(void *), void *arg)
+{
+    timer->expires = 0;
+    timer->fn    = fn;
+    timer->arg   = arg;
+    timer->next  = NULL;
+    timer->pprev = NULL;
+}
+
+/* (Re-)arms `timer' to fire once jiffies reaches `expires' */
+void timer_add(struct timer *timer, uint64_t expires)
+{
+    if (timer_pending(timer))
+        timer_unlink(timer);
+
+    timer->expires = expires;
+    timer_enqueue(timer);
+}
+
+/* Returns 1 if the timer was still pending */
+int timer_del(struct timer *timer)
+{
+    if (!timer_pending(timer))
+        return 0;
+
+    timer_unlink(timer);
+    return 1;
+}
+
+/* Runs all expired timers, called from the clock tick */
+void timer_run()
+{
+    while (timer_jiffies <= jiffies) {
+        int index = timer_jiffies & TVR_MASK;
+
+        if (!index) {
+            for (int level = 0; level < TVN_LEVELS; ++level) {
+                if (timer_cascade(level, TVN_INDEX(timer_jiffies, level)))
+                    break;
+            }
+        }
+
+        /* Timers re-armed from their callback go to the next tick */
+        struct timer *list = tv1[index];
+        tv1[index] = NULL;
+        ++timer_jiffies;
+
+        while (list) {
+            struct timer *timer = list;
+            list = timer->next;
+
+            timer->next  = NULL;
+            timer->pprev = NULL;
+            timer->fn(timer->arg);
+        }
+    }
+}
+
+/*
+ *  Earliest tick a timer may expire at, for tickless idle. Only the first
+ *  level is searched, if it is empty up to the next cascade that is as far
+ *  as we can tell without sorting the levels above.
+ */
+uint64_t timer_next()
+{
+    uint64_t next = timer_jiffies;
+
+    /* A cascade is due, the first level is not filled in yet */
+    if (!(next & TVR_MASK))
+        return next;
+
+    do {
+        if (tv1[next & TVR_MASK])
+            return next;
+    } while (++next & TVR_MASK);
+
+    return next;
+}
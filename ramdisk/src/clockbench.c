@@ -0,0 +1,77 @@
+/*
+ *  Clock read microbenchmark
+ *
+ *  Compares the cost of reading the time from the clock data page against
+ *  a system call round trip (getpid), and checks that the monotonic clock
+ *  never goes backwards.
+ *
+ *  usage: clockbench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+
+#define DEFAULT_ROUNDS  100000
+
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC (clockid_t) 4
+#endif
+
+int clock_gettime(clockid_t clock_id, struct timespec *tp);
+
+static inline uint64_t rdtsc()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc":"=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    struct timespec ts, last = {0, 0};
+    struct timeval tv;
+    int backwards = 0;
+
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < rounds; ++i) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        if (ts.tv_sec < last.tv_sec || (ts.tv_sec == last.tv_sec && ts.tv_nsec < last.tv_nsec))
+            ++backwards;
+
+        last = ts;
+    }
+
+    uint32_t clock_cycles = (uint32_t) ((rdtsc() - start) / rounds);
+
+    start = rdtsc();
+
+    for (int i = 0; i < rounds; ++i)
+        gettimeofday(&tv, NULL);
+
+    uint32_t tod_cycles = (uint32_t) ((rdtsc() - start) / rounds);
+
+    start = rdtsc();
+
+    for (int i = 0; i < rounds; ++i)
+        getpid();
+
+    uint32_t syscall_cycles = (uint32_t) ((rdtsc() - start) / rounds);
+
+    printf("clockbench: %d rounds, cycles per call\n", rounds);
+    printf("clock_gettime %u, gettimeofday %u, getpid (syscall) %u\n",
+            clock_cycles, tod_cycles, syscall_cycles);
+    printf("monotonic: %s (%d backwards steps), now %ld.%06ld since the Epoch\n",
+            backwards ? "BROKEN" : "ok", backwards, (long) tv.tv_sec, (long) tv.tv_usec);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ *  fork/exec latency microbenchmark
+ *
+ *  Grows the process by touching a buffer of each size, then measures
+ *  fork + _exit, fork + exec, vfork + exec and posix_spawn (of this binary,
+ *  which exits right away) round trips including the waitpid.
+ *
+ *  usage: forkbench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#define DEFAULT_ROUNDS  100
+#define SELF            "/bin/forkbench"
+
+enum {
+    FORK_EXIT,
+    FORK_EXEC,
+    VFORK_EXEC,
+    SPAWN,
+};
+
+extern char **environ;
+
+static inline uint64_t rdtsc()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc":"=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static uint32_t bench(int rounds, int how)
+{
+    char *argv[] = {"forkbench", "-x", NULL};
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < rounds; ++i) {
+        pid_t pid;
+
+        if (how == SPAWN) {
+            if (posix_spawn(&pid, SELF, NULL, NULL, argv, environ)) {
+                fprintf(stderr, "forkbench: could not spawn\n");
+                exit(1);
+            }
+        } else {
+            pid = how == VFORK_EXEC ? vfork() : fork();
+
+            if (pid < 0) {
+                fprintf(stderr, "forkbench: could not fork\n");
+                exit(1);
+            }
+
+            if (!pid) {
+                if (how != FORK_EXIT)
+                    execve(SELF, argv, environ);
+
+                _exit(0);
+            }
+        }
+
+        waitpid(pid, NULL, 0);
+    }
+
+    return (uint32_t) ((rdtsc() - start) / rounds);
+}
+
+int main(int argc, char **argv)
+{
+    /* Exec'd child, nothing to do */
+    if (argc > 1 && !strcmp(argv[1], "-x"))
+        return 0;
+
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    size_t sizes[] = {0, 1, 4, 16, 64};   /* MiB */
+
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    printf("forkbench: %d rounds, cycles per round trip\n", rounds);
+    printf("size (MiB)  fork+exit  fork+exec  vfork+exec  spawn\n");
+
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+        size_t size = sizes[i] * 1024 * 1024;
+        char *buf = NULL;
+
+        if (size) {
+            if (!(buf = malloc(size))) {
+                fprintf(stderr, "forkbench: could not allocate %d MiB\n", (int) sizes[i]);
+                break;
+            }
+
+            memset(buf, 1, size);   /* Make it resident */
+        }
+
+        uint32_t fork_exit  = bench(rounds, FORK_EXIT);
+        uint32_t fork_exec  = bench(rounds, FORK_EXEC);
+        uint32_t vfork_exec = bench(rounds, VFORK_EXEC);
+        uint32_t spawn      = bench(rounds, SPAWN);
+
+        printf("%d  %u  %u  %u  %u\n", (int) sizes[i], fork_exit, fork_exec, vfork_exec, spawn);
+
+        free(buf);
+    }
+
+    return 0;
+}
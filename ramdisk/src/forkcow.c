@@ -0,0 +1,117 @@
+/*
+ *  fork copy-on-write check
+ *
+ *  Fills data, heap and stack before forking, then has the child and the
+ *  parent each write their own pattern over all of it, in both orders
+ *  (child first, then parent first). Every process must only ever see its
+ *  own writes, and the first write on either side after a fork is the one
+ *  that unshares the page tables.
+ *
+ *  usage: forkcow [pages]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define DEFAULT_PAGES   64
+#define PAGE_SIZE       4096
+#define STACK_WORDS     1024
+
+static uint32_t data[PAGE_SIZE];    /* 4 pages in .bss */
+
+static void fill(uint32_t *p, size_t n, uint32_t pattern)
+{
+    for (size_t i = 0; i < n; ++i)
+        p[i] = pattern ^ i;
+}
+
+static int check(uint32_t *p, size_t n, uint32_t pattern)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (p[i] != (pattern ^ i))
+            return 1;
+
+    return 0;
+}
+
+/* Writes `pattern' everywhere and checks it, returns the number of bad areas */
+static int write_all(uint32_t *heap, size_t heap_words, uint32_t *stack, uint32_t pattern)
+{
+    fill(data, PAGE_SIZE, pattern);
+    fill(heap, heap_words, pattern);
+    fill(stack, STACK_WORDS, pattern);
+
+    return check(data, PAGE_SIZE, pattern)
+         + check(heap, heap_words, pattern)
+         + check(stack, STACK_WORDS, pattern);
+}
+
+static int cow_round(uint32_t *heap, size_t heap_words, int child_first)
+{
+    uint32_t stack[STACK_WORDS];
+    int go[2], status = -1;
+    char c = 0;
+
+    if (write_all(heap, heap_words, stack, 0x11111111) || pipe(go))
+        return 1;
+
+    pid_t pid = fork();
+
+    if (pid < 0)
+        return 1;
+
+    if (!pid) {
+        if (!child_first)   /* Wait for the parent to write first */
+            read(go[0], &c, 1);
+
+        int bad = write_all(heap, heap_words, stack, 0x22222222);
+
+        if (child_first)
+            write(go[1], &c, 1);
+
+        exit(bad);
+    }
+
+    if (child_first)
+        read(go[0], &c, 1);
+
+    int bad = write_all(heap, heap_words, stack, 0x33333333);
+
+    if (!child_first)
+        write(go[1], &c, 1);
+
+    waitpid(pid, &status, 0);
+    close(go[0]);
+    close(go[1]);
+
+    /* Exit statuses are passed through as is */
+    printf("%s first: parent %s, child %s\n", child_first ? "child" : "parent",
+            bad ? "BROKEN" : "ok", status ? "BROKEN" : "ok");
+
+    return bad || status;
+}
+
+int main(int argc, char **argv)
+{
+    int pages = argc > 1 ? atoi(argv[1]) : DEFAULT_PAGES;
+
+    if (pages <= 0)
+        pages = DEFAULT_PAGES;
+
+    size_t heap_words = pages * PAGE_SIZE / sizeof(uint32_t);
+    uint32_t *heap = malloc(heap_words * sizeof(uint32_t));
+
+    if (!heap) {
+        fprintf(stderr, "forkcow: could not allocate %d pages\n", pages);
+        return 1;
+    }
+
+    int bad = cow_round(heap, heap_words, 1) + cow_round(heap, heap_words, 0);
+
+    printf("forkcow: %s\n", bad ? "FAILED" : "ok");
+
+    return bad;
+}
@@ -0,0 +1,70 @@
+/*
+ *  Context switch microbenchmark
+ *
+ *  Two processes bounce a byte over a pair of pipes, every round trip costs
+ *  two context switches (and two address space switches).
+ *
+ *  usage: pingpong [rounds]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define DEFAULT_ROUNDS  10000
+
+static inline uint64_t rdtsc()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc":"=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    int ping[2], pong[2];
+    char c = 0;
+
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    if (pipe(ping) || pipe(pong)) {
+        fprintf(stderr, "pingpong: could not create pipes\n");
+        return 1;
+    }
+
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        fprintf(stderr, "pingpong: could not fork\n");
+        return 1;
+    }
+
+    if (!pid) { /* Child: echo back everything */
+        for (int i = 0; i < rounds; ++i) {
+            read(ping[0], &c, 1);
+            write(pong[1], &c, 1);
+        }
+
+        exit(0);
+    }
+
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < rounds; ++i) {
+        write(ping[1], &c, 1);
+        read(pong[0], &c, 1);
+    }
+
+    uint64_t cycles = rdtsc() - start;
+
+    waitpid(pid, NULL, 0);
+
+    printf("pingpong: %d round trips, %u cycles per round trip, %u cycles per switch\n",
+            rounds, (uint32_t) (cycles / rounds), (uint32_t) (cycles / rounds / 2));
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ *  Scheduler latency microbenchmark
+ *
+ *  Starts a number of CPU hogs, then bounces a byte with an echo process
+ *  over a pair of pipes. Both ends of the echo loop sleep on I/O between
+ *  messages, every round trip measures how long it takes the scheduler to
+ *  get them running again with the hogs competing for the CPU.
+ *
+ *  Every other hog runs at nice 0, the rest at [hogs nice]. Once done, each
+ *  hog reports how many thousand loops it got through, a niced hog that got
+ *  nowhere was starved.
+ *
+ *  usage: schedlat [hogs] [rounds] [hogs nice]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define DEFAULT_HOGS    4
+#define DEFAULT_ROUNDS  1000
+#define DEFAULT_NICE    10
+#define MAX_HOGS        32
+
+static inline uint64_t rdtsc()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc":"=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static volatile uint64_t loops = 0;
+static int report_fd = -1;
+
+static void hog_report(int sig)
+{
+    write(report_fd, (void *) &loops, sizeof(loops));
+    _exit(0);
+}
+
+static void hog(int incr)
+{
+    nice(incr);
+
+    for (;;)
+        ++loops;
+}
+
+int main(int argc, char **argv)
+{
+    int hogs   = argc > 1 ? atoi(argv[1]) : DEFAULT_HOGS;
+    int rounds = argc > 2 ? atoi(argv[2]) : DEFAULT_ROUNDS;
+    int hogs_nice = argc > 3 ? atoi(argv[3]) : DEFAULT_NICE;
+    pid_t hog_pids[MAX_HOGS];
+    int ping[2], pong[2], report[2];
+    char c = 0;
+
+    if (hogs < 0 || hogs > MAX_HOGS)
+        hogs = DEFAULT_HOGS;
+
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    if (pipe(ping) || pipe(pong) || pipe(report)) {
+        fprintf(stderr, "schedlat: could not create pipes\n");
+        return 1;
+    }
+
+    pid_t echo = fork();
+
+    if (echo < 0) {
+        fprintf(stderr, "schedlat: could not fork\n");
+        return 1;
+    }
+
+    if (!echo) {    /* Echo back everything */
+        for (int i = 0; i < rounds; ++i) {
+            read(ping[0], &c, 1);
+            write(pong[1], &c, 1);
+        }
+
+        exit(0);
+    }
+
+    /* Hogs inherit the handler, a hog killed before it ever ran still
+     * reports back */
+    report_fd = report[1];
+    signal(SIGTERM, hog_report);
+
+    for (int i = 0; i < hogs; ++i) {
+        if (!(hog_pids[i] = fork()))
+            hog(i % 2 ? hogs_nice : 0);
+    }
+
+    signal(SIGTERM, SIG_DFL);
+    close(report[1]);
+
+    uint64_t min = (uint64_t) -1, max = 0, total = 0;
+
+    for (int i = 0; i < rounds; ++i) {
+        uint64_t start = rdtsc();
+
+        write(ping[1], &c, 1);
+        read(pong[0], &c, 1);
+
+        uint64_t cycles = rdtsc() - start;
+
+        total += cycles;
+
+        if (cycles < min)
+            min = cycles;
+
+        if (cycles > max)
+            max = cycles;
+    }
+
+    uint64_t hog_loops[MAX_HOGS];
+
+    /* One at a time, so that the reports come in the order of the hogs */
+    for (int i = 0; i < hogs; ++i) {
+        hog_loops[i] = 0;
+
+        if (hog_pids[i] > 0) {
+            kill(hog_pids[i], SIGTERM);
+            read(report[0], &hog_loops[i], sizeof(hog_loops[i]));
+            waitpid(hog_pids[i], NULL, 0);
+        }
+    }
+
+    waitpid(echo, NULL, 0);
+
+    printf("schedlat: %d hogs (nice 0 and %d), %d round trips\n", hogs, hogs_nice, rounds);
+    printf("cycles per round trip: min %u, avg %u, max %u\n",
+            (uint32_t) min, (uint32_t) (total / rounds), (uint32_t) max);
+
+    for (int i = 0; i < hogs; ++i) {
+        printf("hog %d (nice %d): %u thousand loops%s\n", i, i % 2 ? hogs_nice : 0,
+                (uint32_t) (hog_loops[i] / 1000), hog_loops[i] ? "" : ", STARVED");
+    }
+
+    return 0;
+}
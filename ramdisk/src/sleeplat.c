@@ -0,0 +1,93 @@
+/*
+ *  Timer latency microbenchmark
+ *
+ *  Measures how long nanosleep and an empty poll with a timeout actually
+ *  block for, against the requested delay, then checks that alarm raises
+ *  SIGALRM. Times are in TSC cycles, the cycles per millisecond are taken
+ *  from a 100 ms sleep.
+ *
+ *  usage: sleeplat [rounds]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+
+#define DEFAULT_ROUNDS  20
+
+static inline uint64_t rdtsc()
+{
+    uint32_t lo, hi;
+    asm volatile("rdtsc":"=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static volatile int alarmed = 0;
+
+static void alarm_handler(int sig)
+{
+    alarmed = 1;
+}
+
+static uint64_t bench(int rounds, int ms, int use_poll)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+    int fd[2];
+
+    if (use_poll && pipe(fd)) {
+        fprintf(stderr, "sleeplat: could not create pipe\n");
+        exit(1);
+    }
+
+    struct pollfd pfd = {use_poll ? fd[0] : -1, POLLIN, 0};
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < rounds; ++i) {
+        if (use_poll)
+            poll(&pfd, 1, ms);  /* Nobody writes, always times out */
+        else
+            nanosleep(&ts, NULL);
+    }
+
+    uint64_t cycles = rdtsc() - start;
+
+    if (use_poll) {
+        close(fd[0]);
+        close(fd[1]);
+    }
+
+    return cycles / rounds;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    int delays[] = {1, 10, 50};    /* ms */
+
+    if (rounds <= 0)
+        rounds = DEFAULT_ROUNDS;
+
+    uint32_t cycles_per_ms = (uint32_t) (bench(1, 100, 0) / 100);
+
+    printf("sleeplat: %d rounds, %u cycles per ms\n", rounds, cycles_per_ms);
+    printf("delay (ms)  nanosleep (us)  poll (us)\n");
+
+    for (size_t i = 0; i < sizeof(delays)/sizeof(delays[0]); ++i) {
+        uint32_t sleep_us = (uint32_t) (bench(rounds, delays[i], 0) * 1000 / cycles_per_ms);
+        uint32_t poll_us  = (uint32_t) (bench(rounds, delays[i], 1) * 1000 / cycles_per_ms);
+
+        printf("%d  %u  %u\n", delays[i], sleep_us, poll_us);
+    }
+
+    signal(SIGALRM, alarm_handler);
+    alarm(1);
+    sleep(2);
+
+    printf("alarm: %s\n", alarmed ? "ok" : "no SIGALRM");
+
+    return 0;
+}
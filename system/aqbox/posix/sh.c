@@ -6,6 +6,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <dirent.h>
+#include <spawn.h>
 
 #include <sys/wait.h>
 #include <sys/mount.h>
@@ -95,16 +96,20 @@ void print_prompt()
 
 int run_prog(char *name, char **argv)
 {
-    int cld;
-    if (cld = fork()) {
-        int s, pid;
-        do {
-            pid = waitpid(cld, &s, 0);
-        } while (pid != cld);
-    } else {
-        int x = execve(name, argv, environ);
-        exit(x);
+    pid_t cld;
+    int err = posix_spawn(&cld, name, NULL, NULL, argv, environ);
+
+    if (err) {
+        fprintf(stderr, "aqsh: %s: %s\n", name, strerror(err));
+        return err;
     }
+
+    int s, pid;
+    do {
+        pid = waitpid(cld, &s, 0);
+    } while (pid != cld);
+
+    return s;
 }
 
 int eval()
@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <fb.h>
 
 #define _NJ_INCLUDE_HEADER_ONLY
@@ -15,6 +16,16 @@ static struct fb_fix_screeninfo fix_screeninfo;
 static struct fb_var_screeninfo var_screeninfo;
 static int fb = -1;
 static unsigned xres, yres, line_length;
+static char *fbmem = NULL;  /* Mapped framebuffer, NULL if mmap is not supported */
+
+/* Rows touched since the last render */
+static unsigned dirty_top = -1U, dirty_bottom = 0;
+
+static inline void fb_dirty(unsigned top, unsigned bottom)
+{
+    if (top < dirty_top) dirty_top = top;
+    if (bottom > dirty_bottom) dirty_bottom = bottom;
+}
 
 #define COLORMERGE(f, b, c)	((b) + (((f) - (b)) * (c) >> 8u))
 #define _R(c)   (((c) >> 3*8) & 0xFF)
@@ -26,6 +37,7 @@ void fb_put_pixel(struct fbterm_ctx *ctx, int x, int y, uint32_t color)
 {
     unsigned char a = _A(color);
     unsigned char *p = &ctx->backbuf[y * line_length + 3*x];
+    fb_dirty(y, y + 1);
 
     p[0] = COLORMERGE(_R(color), p[0], a);  /* Red */
     p[1] = COLORMERGE(_G(color), p[1], a);  /* Green */
@@ -38,12 +50,28 @@ void fb_clear(struct fbterm_ctx *ctx)
 
     if (ctx->wallpaper)
         memcpy(ctx->backbuf, ctx->wallpaper, yres*line_length);
+
+    fb_dirty(0, yres);
 }
 
+/* Copy dirty rows of the back buffer to the screen */
 void fb_render(struct fbterm_ctx *ctx)
 {
-    lseek(fb, 0, SEEK_SET);
-    write(fb, ctx->backbuf, line_length * yres);
+    if (dirty_top >= dirty_bottom)
+        return;
+
+    size_t off  = dirty_top * line_length;
+    size_t size = (dirty_bottom - dirty_top) * line_length;
+
+    if (fbmem) {
+        memcpy(fbmem + off, ctx->backbuf + off, size);
+    } else {
+        lseek(fb, off, SEEK_SET);
+        write(fb, ctx->backbuf + off, size);
+    }
+
+    dirty_top = -1U;
+    dirty_bottom = 0;
 }
 
 void fb_term_init(struct fbterm_ctx *ctx)
@@ -62,20 +90,25 @@ int fb_cook_wallpaper(struct fbterm_ctx *ctx, char *path)
     size_t size = lseek(img, 0, SEEK_END);
     lseek(img, 0, SEEK_SET);
 
-    char *buf = calloc(1, size);
-    read(img, buf, size);
+    /* Map the image instead of copying it, pages are read as decoded */
+    char *buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, img, 0);
     close(img);
 
+    if (buf == MAP_FAILED) {
+        fprintf(stderr, "Error mapping input file: %d\n", errno);
+        return -1;
+    }
+
     njInit();
     int err = 0;
 
     if (err = njDecode(buf, size)) {
-        free(buf);
+        munmap(buf, size);
         fprintf(stderr, "Error decoding input file: %d\n", err);
         return -1;
     }
 
-    free(buf);
+    munmap(buf, size);
     size_t height = njGetHeight();
     size_t width  = njGetWidth();
     size_t cook_height, cook_width;
@@ -118,6 +151,7 @@ int fb_cook_wallpaper(struct fbterm_ctx *ctx, char *path)
     njDone();
 
     memcpy(ctx->backbuf, ctx->wallpaper, yres*line_length);
+    fb_dirty(0, yres);
     return 0;
 }
 
@@ -144,5 +178,11 @@ int fb_init(char *path)
     xres = var_screeninfo.xres;
     yres = var_screeninfo.yres;
 
+    /* Render straight into video memory if the driver lets us map it */
+    fbmem = mmap(NULL, yres * line_length, PROT_READ | PROT_WRITE, MAP_SHARED, fb, 0);
+
+    if (fbmem == MAP_FAILED)
+        fbmem = NULL;
+
     return 0;
 }